@@ -24,18 +24,99 @@
 
 #pragma once
 
+#include <type_traits>
+
 #if defined (_MSC_VER)
 #include <intrin.h>
 #endif
+#if defined (__GNUC__) && defined (__BMI2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Compile time bit primitives
+ *
+ * C++11 constexpr functions hold a single return statement, so these
+ * recurse: clz and ctz halve the search width, popcount, pext and pdep
+ * step once per set bit. The runtime versions below use the builtins.
+ * All of them are defined for zero and return the type width.
+ */
+
+/*! const_clz */
+template <typename T>
+constexpr int const_clz_r(T val, int bits, int s)
+{
+	return s == 0 ? 0 : (val >> (bits - s)) == 0
+		? s + const_clz_r<T>(T(val << s), bits, s >> 1)
+		: const_clz_r<T>(val, bits, s >> 1);
+}
+
+template <typename T>
+constexpr int const_clz(T val)
+{
+	return val == 0 ? int(sizeof(T) << 3)
+		: const_clz_r<T>(val, int(sizeof(T) << 3), int(sizeof(T) << 2));
+}
+
+/*! const_ctz */
+template <typename T>
+constexpr int const_ctz_r(T val, int s)
+{
+	return s == 0 ? 0 : (val & ((T(1) << s) - 1)) == 0
+		? s + const_ctz_r<T>(T(val >> s), s >> 1)
+		: const_ctz_r<T>(val, s >> 1);
+}
+
+template <typename T>
+constexpr int const_ctz(T val)
+{
+	return val == 0 ? int(sizeof(T) << 3) : const_ctz_r<T>(val, int(sizeof(T) << 2));
+}
+
+/*! const_popcount */
+template <typename T>
+constexpr int const_popcount(T val)
+{
+	return val == 0 ? 0 : 1 + const_popcount<T>(T(val & (val - 1)));
+}
+
+/*! const_pext - gather the bits of val selected by mask into the low bits */
+template <typename T>
+constexpr T const_pext(T val, T mask)
+{
+	return mask == 0 ? T(0) : T(T((val & mask & T(~mask + 1)) != 0) |
+		T(const_pext<T>(val, T(mask & (mask - 1))) << 1));
+}
+
+/*! const_pdep - scatter the low bits of val to the bits set in mask */
+template <typename T>
+constexpr T const_pdep(T val, T mask)
+{
+	return mask == 0 ? T(0) : T(((val & 1) ? T(mask & T(~mask + 1)) : T(0)) |
+		const_pdep<T>(T(val >> 1), T(mask & (mask - 1))));
+}
+
+/*
+ * Runtime bit primitives
+ *
+ * The generic versions take O(log n) steps for clz, ctz and popcount.
+ * 8-bit and 16-bit types set a guard bit above the value so that the
+ * 32-bit instruction is defined for zero. The 32-bit and 64-bit
+ * builtins are undefined for zero unless LZCNT and TZCNT are enabled.
+ */
 
 /*! clz */
 template <typename T>
 inline int clz(T val)
 {
 	const int bits = sizeof(T) << 3;
-	unsigned count = 0, found = 0;
-	for (int i = bits - 1; i >= 0; --i) {
-		count += !(found |= val & T(1)<<i ? 1 : 0);
+	if (val == 0) return bits;
+	int count = 0;
+	for (int s = bits >> 1; s > 0; s >>= 1) {
+		if ((val >> (bits - s)) == 0) {
+			val = T(val << s);
+			count += s;
+		}
 	}
 	return count;
 }
@@ -45,18 +126,26 @@ template <typename T>
 inline int ctz(T val)
 {
 	const int bits = sizeof(T) << 3;
-	unsigned count = 0, found = 0;
-	for (int i = 0; i < bits; ++i) {
-		count += !(found |= val & T(1)<<i ? 1 : 0);
+	if (val == 0) return bits;
+	int count = 0;
+	for (int s = bits >> 1; s > 0; s >>= 1) {
+		if ((val & ((T(1) << s) - 1)) == 0) {
+			val = T(val >> s);
+			count += s;
+		}
 	}
 	return count;
 }
 
 /* ctz specializations */
 #if defined (__GNUC__)
+template<> inline int clz(unsigned char val) { return __builtin_clz((unsigned)val << 24 | 0x800000u); }
+template<> inline int clz(unsigned short val) { return __builtin_clz((unsigned)val << 16 | 0x8000u); }
 template<> inline int clz(unsigned val) { return __builtin_clz(val); }
 template<> inline int clz(unsigned long val) { return __builtin_clzll(val); }
 template<> inline int clz(unsigned long long val) { return __builtin_clzll(val); }
+template<> inline int ctz(unsigned char val) { return __builtin_ctz(val | 0x100u); }
+template<> inline int ctz(unsigned short val) { return __builtin_ctz(val | 0x10000u); }
 template<> inline int ctz(unsigned val) { return __builtin_ctz(val); }
 template<> inline int ctz(unsigned long val) { return __builtin_ctzll(val); }
 template<> inline int ctz(unsigned long long val) { return __builtin_ctzll(val); }
@@ -101,4 +190,87 @@ template<> inline int ctz(unsigned long long val)
 	return _BitScanForward64(&count, val);
 }
 #endif
+template<> inline int clz(unsigned char val) { return clz((unsigned)val << 24 | 0x800000u); }
+template<> inline int clz(unsigned short val) { return clz((unsigned)val << 16 | 0x8000u); }
+template<> inline int clz(unsigned long val) { return clz((unsigned)val); }
+template<> inline int ctz(unsigned char val) { return ctz(val | 0x100u); }
+template<> inline int ctz(unsigned short val) { return ctz(val | 0x10000u); }
+template<> inline int ctz(unsigned long val) { return ctz((unsigned)val); }
+#endif
+
+/*! popcount */
+template <typename T>
+inline int popcount(T val)
+{
+	/* zero extend so signed types count only their own bits */
+	unsigned long long x = typename std::make_unsigned<T>::type(val);
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
+/* popcount specializations */
+#if defined (__GNUC__)
+template<> inline int popcount(unsigned char val) { return __builtin_popcount(val); }
+template<> inline int popcount(unsigned short val) { return __builtin_popcount(val); }
+template<> inline int popcount(unsigned val) { return __builtin_popcount(val); }
+template<> inline int popcount(unsigned long val) { return __builtin_popcountll(val); }
+template<> inline int popcount(unsigned long long val) { return __builtin_popcountll(val); }
+#endif
+#if defined (_MSC_VER) && defined (_M_X64)
+template<> inline int popcount(unsigned val)
+{
+	return (int)__popcnt(val);
+}
+template<> inline int popcount(unsigned long long val)
+{
+	return (int)__popcnt64(val);
+}
+#endif
+
+/*! pext - gather the bits of val selected by mask into the low bits */
+template <typename T>
+inline T pext(T val, T mask)
+{
+	T res = 0;
+	for (T bit = 1; mask != 0; bit = T(bit << 1), mask = T(mask & (mask - 1))) {
+		if (val & mask & T(~mask + 1)) res = T(res | bit);
+	}
+	return res;
+}
+
+/*! pdep - scatter the low bits of val to the bits set in mask */
+template <typename T>
+inline T pdep(T val, T mask)
+{
+	T res = 0;
+	for (; mask != 0; val = T(val >> 1), mask = T(mask & (mask - 1))) {
+		if (val & 1) res = T(res | (mask & T(~mask + 1)));
+	}
+	return res;
+}
+
+/* pext and pdep specializations */
+#if defined (__BMI2__) && (defined (__x86_64__) || defined (_M_X64))
+template<> inline unsigned pext(unsigned val, unsigned mask) { return _pext_u32(val, mask); }
+template<> inline unsigned pdep(unsigned val, unsigned mask) { return _pdep_u32(val, mask); }
+template<> inline unsigned long long pext(unsigned long long val, unsigned long long mask)
+{
+	return _pext_u64(val, mask);
+}
+template<> inline unsigned long long pdep(unsigned long long val, unsigned long long mask)
+{
+	return _pdep_u64(val, mask);
+}
+#if defined (__GNUC__)
+template<> inline unsigned long pext(unsigned long val, unsigned long mask)
+{
+	return _pext_u64(val, mask);
+}
+template<> inline unsigned long pdep(unsigned long val, unsigned long mask)
+{
+	return _pdep_u64(val, mask);
+}
+#endif
 #endif
@@ -29,15 +29,146 @@
 #include <cstring>
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <array>
 
 #include "bits.h"
 
+/*
+ * SIMD kernels are compiled with target attributes and selected at
+ * runtime, so a generic build runs the BMI2, AVX2 and AVX-512 kernels
+ * on hosts that support them. Other compilers use these kernels only
+ * when the whole build targets them. Define USE_BMI2=0, USE_AVX2=0 or
+ * USE_AVX512_VBMI2=0 to leave out a set of kernels.
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#ifndef USE_BMI2
+#define USE_BMI2 1
+#endif
+#ifndef USE_AVX2
+#define USE_AVX2 1
+#endif
+#ifndef USE_AVX512_VBMI2
+#define USE_AVX512_VBMI2 1
+#endif
+#define VLU_TARGET_BMI2 __attribute__((target("bmi,bmi2")))
+#define VLU_FLATTEN __attribute__((flatten))
+#define VLU_TARGET_AVX2 __attribute__((target("popcnt,bmi,bmi2,avx2")))
+#define VLU_TARGET_AVX512 __attribute__((target( \
+    "popcnt,avx512f,avx512bw,avx512cd,avx512vl,avx512vbmi,avx512vbmi2")))
+#else
+#if !defined(USE_BMI2) && defined(__BMI2__)
+#define USE_BMI2 1
+#endif
+#if !defined(USE_AVX2) && defined(__AVX2__)
+#define USE_AVX2 1
+#endif
+#define VLU_TARGET_BMI2
+#define VLU_TARGET_AVX2
+#define VLU_FLATTEN
+#endif
+
+/*
+ * GCC warns that the undefined pass-through operand used inside some
+ * AVX-512 intrinsics may be uninitialized, so the AVX-512 kernels are
+ * bracketed with VLU_AVX512_BEGIN and VLU_AVX512_END.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#define VLU_AVX512_BEGIN _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define VLU_AVX512_END _Pragma("GCC diagnostic pop")
+#else
+#define VLU_AVX512_BEGIN
+#define VLU_AVX512_END
+#endif
+
+#if USE_BMI2 || USE_AVX2 || USE_AVX512_VBMI2 || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64)
 #ifndef USE_UNALIGNED_ACCESSES
 #define USE_UNALIGNED_ACCESSES 1
 #endif
 #endif
 
+/*
+ * vlu_cpu - instruction set extensions detected once at runtime
+ */
+struct vlu_cpu
+{
+    bool bmi2;
+    bool avx2;
+    bool avx512vbmi2;
+
+    vlu_cpu() : bmi2(false), avx2(false), avx512vbmi2(false)
+    {
+#if defined(__GNUC__) && defined(__x86_64__)
+        __builtin_cpu_init();
+        bmi2 = __builtin_cpu_supports("bmi") &&
+               __builtin_cpu_supports("bmi2");
+        avx2 = bmi2 &&
+               __builtin_cpu_supports("popcnt") &&
+               __builtin_cpu_supports("avx2");
+        avx512vbmi2 = __builtin_cpu_supports("popcnt") &&
+                      __builtin_cpu_supports("avx512f") &&
+                      __builtin_cpu_supports("avx512bw") &&
+                      __builtin_cpu_supports("avx512cd") &&
+                      __builtin_cpu_supports("avx512vl") &&
+                      __builtin_cpu_supports("avx512vbmi") &&
+                      __builtin_cpu_supports("avx512vbmi2");
+#else
+#if defined(__BMI2__)
+        bmi2 = true;
+#endif
+#if defined(__AVX2__)
+        avx2 = true;
+#endif
+#endif
+    }
+};
+
+static const vlu_cpu& vlu_get_cpu()
+{
+    static const vlu_cpu cpu;
+    return cpu;
+}
+
+/*
+ * vlu_cpu_bmi2, vlu_cpu_avx2, vlu_cpu_avx512vbmi2 - runtime checks for the kernels
+ *
+ * The checks are constant when the build already targets the extension.
+ */
+static inline bool vlu_cpu_bmi2()
+{
+#if defined(__BMI__) && defined(__BMI2__)
+    return true;
+#else
+    return vlu_get_cpu().bmi2;
+#endif
+}
+
+static inline bool vlu_cpu_avx2()
+{
+#if defined(__AVX2__) && defined(__BMI__) && defined(__BMI2__) && defined(__POPCNT__)
+    return true;
+#else
+    return vlu_get_cpu().avx2;
+#endif
+}
+
+static inline bool vlu_cpu_avx512vbmi2()
+{
+#if defined(__AVX512VL__) && defined(__AVX512BW__) && defined(__AVX512CD__) && \
+    defined(__AVX512VBMI__) && defined(__AVX512VBMI2__) && defined(__POPCNT__)
+    return true;
+#else
+    return vlu_get_cpu().avx512vbmi2;
+#endif
+}
+
 /*
  * Bit field macros
  */
@@ -115,6 +246,12 @@ struct vlu_result
     int64_t shamt;
 };
 
+struct vlu_io_result
+{
+    size_t nread;
+    size_t nwritten;
+};
+
 /*
  * vlu_encoded_size_56 - VLU8 packet size in bytes
  */
@@ -132,7 +269,7 @@ static int vlu_encoded_size_56(uint64_t num, uint64_t limit = 8)
  */
 static int vlu_decoded_size_56(uint64_t uvlu, uint64_t limit = 8)
 {
-    int t1 = ctz(~uvlu);
+    int t1 = ctz(~uvlu | (1ull << limit));
     bool cont = t1 >= limit;
     int shamt = cont ? limit : t1 + 1;
     return shamt;
@@ -162,6 +299,10 @@ static struct vlu_result vlu_encode_56(uint64_t num, uint64_t limit = 8)
 /*
  * vlu_decode_56 - VLU8 decoding with continuation support
  *
+ * vlu_decode_56_bmi2 is inline asm using tzcnt, shrx, shlx and andn,
+ * and may be called on any CPU with BMI2 whatever the build targets.
+ * vlu_decode_56 uses it when the build targets BMI2.
+ *
  * @param vlu value to decode
  * @param limit for continuation
  * @returns (struct vlu_result) {
@@ -169,8 +310,9 @@ static struct vlu_result vlu_encode_56(uint64_t num, uint64_t limit = 8)
  *   shamt: shift value from 1 to 8, or -1 for continuation
  * }
  */
-#if defined (__GNUC__) && defined(__x86_64__)
-static vlu_result vlu_decode_56(uint64_t vlu, uint64_t limit = 8)
+#if defined(__GNUC__) && defined(__x86_64__) && (USE_BMI2 || (defined(__BMI__) && defined(__BMI2__)))
+#define VLU_ASM_BMI2 1
+static vlu_result vlu_decode_56_bmi2(uint64_t vlu, uint64_t limit = 8)
 {
     struct vlu_result r;
     uint64_t tmp1, tmp2;
@@ -183,7 +325,7 @@ static vlu_result vlu_decode_56(uint64_t vlu, uint64_t limit = 8)
         "setge   %b[tmp2]                   \n\t" /* shamt >= limit */
         "lea     1(%[tmp1]), %[shamt]       \n\t" /* shamt = tz + 1*/
         "mov     %[limit], %[tmp1]          \n\t"
-        "cmovg   %[tmp1], %[shamt]          \n\t" /* shamt >= limit */
+        "cmovge  %[tmp1], %[shamt]          \n\t" /* shamt >= limit */
         "imul    $7, %[shamt], %[tmp1]      \n\t" /* st7 = shamt * 7 */
         "shrx    %[shamt], %[vlu], %[val]   \n\t" /* r = vlu >> shamt */
         "neg     %[tmp2]                    \n\t" /* mk8 = -(shamt >= limit) */
@@ -198,248 +340,3191 @@ static vlu_result vlu_decode_56(uint64_t vlu, uint64_t limit = 8)
     );
     return r;
 }
-#else
-static vlu_result vlu_decode_56(uint64_t vlu, uint64_t limit = 8)
+#endif
+
+static vlu_result vlu_decode_56_scalar(uint64_t vlu, uint64_t limit = 8)
 {
-    int t1 = ctz(~vlu);
+    int t1 = ctz(~vlu | (1ull << limit));
     bool cont = t1 >= limit;
     int shamt = cont ? limit : t1 + 1;
-    uint64_t mask = ~(-(int64_t)!cont << (shamt * 7));
+    uint64_t mask = cont ? ~0ull : ~(~0ull << (shamt * 7));
     uint64_t num = (vlu >> shamt) & mask;
     return vlu_result{ num, shamt | -(int64_t)cont };
 }
-#endif
 
-/*
- * vlu_size_vec - calculate packed size in bytes
- */
-static size_t vlu_size_vec(std::vector<uint64_t> &vec)
+static vlu_result vlu_decode_56(uint64_t vlu, uint64_t limit = 8)
 {
-    size_t len = 0;
-    for (uint64_t val : vec) {
-        size_t shamt = vlu_encoded_size_56(val);
-        assert(shamt > 0 && shamt < 9);
-        len += shamt;
-    }
-    return len;
+#if VLU_ASM_BMI2 && defined(__BMI__) && defined(__BMI2__)
+    return vlu_decode_56_bmi2(vlu, limit);
+#else
+    return vlu_decode_56_scalar(vlu, limit);
+#endif
 }
 
 /*
- * vlu_size_vec - get size of array
+ * vlu_step_scalar, vlu_step_bmi2 - packet decode step for the bulk kernels
+ *
+ * The decode loops take the step as a template parameter, so a generic
+ * build also has a copy of each loop using the BMI2 step, which the
+ * entry points select at runtime.
  */
-#if USE_UNALIGNED_ACCESSES
-static size_t vlu_items_vec(std::vector<uint8_t> &vec)
-{
-    size_t items = 0;
-    size_t l = vec.size();
-    for (size_t i = 0 ; i < l;) {
-        uint64_t d = 0;
-        size_t s = std::min((size_t)8,l-i);
-        switch (s) {
-        case 1: d = *reinterpret_cast<uint8_t*>(&vec[i]); break;
-        case 2: d = *reinterpret_cast<uint16_t*>(&vec[i]); break;
-        case 3: std::memcpy(&d, &vec[i], s); break;
-        case 4: d = *reinterpret_cast<uint32_t*>(&vec[i]); break;
-        case 5: case 6: case 7: std::memcpy(&d, &vec[i], s); break;
-        case 8: d = *reinterpret_cast<uint64_t*>(&vec[i]); break;
-        default: std::memcpy(&d, &vec[i], s); break;
-        }
-        size_t shamt = vlu_decoded_size_56(d);
-        assert(shamt > 0 && shamt < 9);
-        i += shamt;
-        items++;
-    }
-    return items;
-}
-#else
-static size_t vlu_items_vec(std::vector<uint8_t> &vec)
+struct vlu_step_scalar
 {
-    size_t items = 0;
-    ptrdiff_t l = vec.size();
-
-    ptrdiff_t shamt = 8;
-    uint64_t lo = 0, hi;
-
-    size_t s = std::min((size_t)8, (size_t)l);
-    switch (s) {
-    case 0: hi = 0; break;
-    case 8: hi = *reinterpret_cast<uint64_t*>(&vec[0]); break;
-    default: hi = 0; std::memcpy(&hi, &vec[0], s); break;
-    }
+    static vlu_result decode_56(uint64_t vlu) { return vlu_decode_56(vlu); }
+};
 
-    for (ptrdiff_t i = 0, j = i - shamt; i < l;) {
+#if VLU_ASM_BMI2
+struct vlu_step_bmi2
+{
+    static vlu_result decode_56(uint64_t vlu) { return vlu_decode_56_bmi2(vlu); }
+};
+#endif
 
-        if ((i>>3) > (j>>3)) {
-            ptrdiff_t x = (i&~7)+8;
-            lo = hi;
-            size_t s = std::max((ptrdiff_t)0,std::min((ptrdiff_t)8, l-x));
-            switch (s) {
-            case 0: hi = 0; break;
-            case 8: hi = *reinterpret_cast<uint64_t*>(&vec[x]); break;
-            default: hi = 0; std::memcpy(&hi, &vec[x], s); break;
-            }
-        }
-        size_t y = (i&7)<<3;
-        uint64_t data = y == 0 ? lo : (lo >> y) | (hi << -y);
+/*
+ * VLU8 with a 16-bit prefix limit, encoding up to 112-bits in 16 bytes
+ *
+ * Values and encoded intervals are 128-bit quantities held in two
+ * words. Packets of up to 8 bytes are identical to the 56-bit form;
+ * longer packets have a first byte of 0xff and continue the unary
+ * prefix into the second byte. Wider values take a continuation
+ * interval and a terminal packet for the top 16 bits.
+ */
 
-        shamt = vlu_decoded_size_56(data);
-        assert(shamt > 0 && shamt < 9);
+struct vlu_u128
+{
+    uint64_t lo;
+    uint64_t hi;
+};
 
-        items++;
-        j = i;
-        i += shamt;
-    }
+struct vlu_result_112
+{
+    uint64_t lo;
+    uint64_t hi;
+    int64_t shamt;
+};
 
-    return items;
+/*
+ * vlu_encoded_size_112 - VLU8 packet size in bytes
+ */
+static int vlu_encoded_size_112(uint64_t lo, uint64_t hi, uint64_t limit = 16)
+{
+    if (!(lo | hi)) return 1;
+    int lz = hi ? clz(hi) : 64 + clz(lo);
+    int t1 = (134 - lz) / 7;
+    bool cont = t1 > (int)limit;
+    return cont ? limit : t1;
 }
-#endif
 
 /*
- * vlu_encode_vec - encode array
+ * vlu_decoded_size_112 - VLU8 packet size in bytes
+ *
+ * Only the low 16 bits of the interval are required.
  */
-#if USE_UNALIGNED_ACCESSES
-static void vlu_encode_vec(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+static int vlu_decoded_size_112(uint64_t lo, uint64_t limit = 16)
 {
-    size_t l = src.size();
-    size_t o = 0;
+    int t1 = ctz(~lo | (1ull << limit));
+    bool cont = t1 >= (int)limit;
+    return cont ? limit : t1 + 1;
+}
 
-    size_t items = vlu_size_vec(src);
-    dst.resize(items);
+/*
+ * vlu_encode_112 - VLU8 encoding with continuation support
+ *
+ * returns {
+ *   lo, hi: encoded interval
+ *   shamt:  shift value from 1 to 16, or -1 for continuation
+ * }
+ */
+static vlu_result_112 vlu_encode_112(uint64_t lo, uint64_t hi, uint64_t limit = 16)
+{
+    if (!(lo | hi)) return vlu_result_112{ 0, 0, 1 };
+    int lz = hi ? clz(hi) : 64 + clz(lo);
+    int t1 = (134 - lz) / 7;
+    bool cont = t1 > (int)limit;
+    int shamt = cont ? limit : t1;
+    uint64_t ehi = (hi << shamt) | (lo >> (64 - shamt));
+    uint64_t elo = (lo << shamt)
+        | ((1ull << (shamt-1))-1)
+        | ((uint64_t)cont << (limit-1));
+    return vlu_result_112{ elo, ehi, shamt | -(int64_t)cont };
+}
 
-    ptrdiff_t i = 0;
-    for (uint64_t v : src)
-    {
-        vlu_result r = vlu_encode_56(v);
-        switch (r.shamt) {
-        case 8: *reinterpret_cast<uint64_t*>(&dst[o]) = r.val; break;
-        default: std::memcpy(&dst[o], &r.val, r.shamt); break;
-        }
-        assert(r.shamt > 0 && r.shamt < 9);
-        o += r.shamt;
-    }
+/*
+ * vlu_decode_112 - VLU8 decoding with continuation support
+ *
+ * The value is shifted down across the word boundary and the bits
+ * above 7 * shamt are cleared, which with BMI2 is shrd, shrx and two
+ * bzhi, independent of the packet size.
+ *
+ * returns {
+ *   lo, hi: decoded value
+ *   shamt:  shift value from 1 to 16, or -1 for continuation
+ * }
+ */
+#if USE_BMI2 || defined(__BMI2__)
+VLU_TARGET_BMI2
+static vlu_result_112 vlu_decode_112_bmi2(uint64_t lo, uint64_t hi, uint64_t limit = 16)
+{
+    int t1 = (int)_tzcnt_u64(~lo | (1ull << limit));
+    bool cont = t1 >= (int)limit;
+    int shamt = cont ? limit : t1 + 1;
+    uint64_t vlo = (lo >> shamt) | (hi << (64 - shamt));
+    uint64_t vhi = hi >> shamt;
+    unsigned bits = cont ? 128 - shamt : shamt * 7;
+    vlo = _bzhi_u64(vlo, bits);
+    vhi = _bzhi_u64(vhi, bits > 64 ? bits - 64 : 0);
+    return vlu_result_112{ vlo, vhi, shamt | -(int64_t)cont };
 }
-#else
-static void vlu_encode_vec(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+#endif
+
+static vlu_result_112 vlu_decode_112_scalar(uint64_t lo, uint64_t hi, uint64_t limit = 16)
 {
-    size_t o = 0;
+    int t1 = ctz(~lo | (1ull << limit));
+    bool cont = t1 >= (int)limit;
+    int shamt = cont ? limit : t1 + 1;
+    uint64_t vlo = (lo >> shamt) | (hi << (64 - shamt));
+    uint64_t vhi = hi >> shamt;
+    unsigned bits = cont ? 128 - shamt : shamt * 7;
+    vlo &= bits >= 64 ? ~0ull : (1ull << bits) - 1;
+    vhi &= bits <= 64 ? 0 : (1ull << (bits - 64)) - 1;
+    return vlu_result_112{ vlo, vhi, shamt | -(int64_t)cont };
+}
 
-    uint64_t lo = 0, hi = 0;
+static vlu_result_112 vlu_decode_112(uint64_t lo, uint64_t hi, uint64_t limit = 16)
+{
+#if defined(__BMI2__)
+    return vlu_decode_112_bmi2(lo, hi, limit);
+#else
+    return vlu_decode_112_scalar(lo, hi, limit);
+#endif
+}
 
-    size_t items = vlu_size_vec(src);
-    dst.resize(items);
-    ptrdiff_t l = dst.size();
+/*
+ * vlu_step_112_scalar, vlu_step_112_bmi2 - packet decode step for the 128-bit kernel
+ */
+struct vlu_step_112_scalar
+{
+    static vlu_result_112 decode_112(uint64_t lo, uint64_t hi) { return vlu_decode_112(lo, hi); }
+};
 
-    ptrdiff_t i = 0, j = 0;
-    for (uint64_t v : src)
-    {
-        vlu_result r = vlu_encode_56(v);
+#if USE_BMI2
+struct vlu_step_112_bmi2
+{
+    VLU_TARGET_BMI2
+    static vlu_result_112 decode_112(uint64_t lo, uint64_t hi) { return vlu_decode_112_bmi2(lo, hi); }
+};
+#endif
 
-        size_t y = (i&7)<<3;
-        if (y == 0) {
-            lo = r.val;
-        } else {
-            lo |= (r.val << y);
-            hi |= (r.val >> -y);
-        }
+/*
+ * Full 128-bit values
+ *
+ * Values above 112 bits are encoded as a continuation interval holding
+ * the low 112 bits, two bytes of 0xff followed by 14 bytes, and a
+ * terminal packet of 1 to 3 bytes holding the top 16 bits, 17 to 19
+ * bytes in all. Packets are read and written through 24 byte windows.
+ */
 
-        j = i;
-        i += r.shamt;
-        o++;
+/*
+ * vlu_encoded_size_128 - VLU8 packet size in bytes, from 1 to 19
+ */
+static int vlu_encoded_size_128(uint64_t lo, uint64_t hi)
+{
+    return (hi >> 48) ? 16 + vlu_encoded_size_112(hi >> 48, 0)
+                      : vlu_encoded_size_112(lo, hi);
+}
 
-        if ((i>>3) > (j>>3)) {
-            ptrdiff_t x = (i&~7)-8;
-            size_t s = std::max((ptrdiff_t)0,std::min((ptrdiff_t)8, l-x));
-            switch (s) {
-            case 0: lo = 0; break;
-            case 8: *reinterpret_cast<uint64_t*>(&dst[x]) = lo; lo = 0; break;
-            default: std::memcpy(&dst[x], &lo, s); lo = 0; break;
-            }
-            lo = hi;
-            hi = 0;
-        }
-    }
+/*
+ * vlu_encode_128 - write packet of a full 128-bit value
+ *
+ * Writes 16 or 24 bytes to p and returns the packet size.
+ */
+static int vlu_encode_128(uint8_t *p, uint64_t lo, uint64_t hi)
+{
+    vlu_result_112 r = vlu_encode_112(lo, hi);
+    std::memcpy(p, &r.lo, 8);
+    std::memcpy(p + 8, &r.hi, 8);
+    if (r.shamt > 0) return (int)r.shamt;
+    vlu_result_112 t = vlu_encode_112(hi >> 48, 0);
+    std::memcpy(p + 16, &t.lo, 8);
+    return 16 + (int)t.shamt;
 }
-#endif
 
 /*
- * vlu_decode_vec - decode array
+ * vlu_decode_128 - read packet of a full 128-bit value
+ *
+ * Reads 16 or 24 bytes from p. The terminal after a continuation is 1
+ * to 3 bytes and its size is found from the two low bits, like the
+ * terminal of vlu_decode_64.
+ *
+ * returns {
+ *   lo, hi: decoded value
+ *   shamt:  packet size from 1 to 19
+ * }
  */
-#if USE_UNALIGNED_ACCESSES
-static void vlu_decode_vec(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+template <typename S>
+static vlu_result_112 vlu_decode_128(const uint8_t *p)
 {
-    size_t l = src.size();
-    size_t i = 0, o = 0;
+    uint64_t lo, hi, t;
+    std::memcpy(&lo, p, 8);
+    std::memcpy(&hi, p + 8, 8);
+    vlu_result_112 r = S::decode_112(lo, hi);
+    if (r.shamt > 0) return r;
+    std::memcpy(&t, p + 16, 8);
+    int shamt = ctz(~t | 4) + 1;
+    uint64_t top = (t >> shamt) & ~(~0ull << (7 * shamt)) & 0xffff;
+    return vlu_result_112{ r.lo, r.hi | (top << 48), 16 + shamt };
+}
 
-    size_t items = vlu_items_vec(src);
-    dst.resize(items);
+/*
+ * Full 64-bit values
+ *
+ * Values above 56 bits are encoded as a continuation interval holding
+ * the low 56 bits, 0xff followed by 7 bytes, and a terminal packet of
+ * 1 or 2 bytes holding the top 8 bits, 9 or 10 bytes in all. This is
+ * the one limb case of the arbitrary precision encoding.
+ */
 
-    for (; i < l - 8; )  {
-        uint64_t d = *reinterpret_cast<uint64_t*>(&src[i]);
-        vlu_result r = vlu_decode_56(d);
-        assert(r.shamt > 0);
-        assert(o < items);
-        dst[o] = r.val;
-        i += r.shamt;
-        o++;
-    }
+/*
+ * vlu_encoded_size_64 - VLU8 packet size in bytes, from 1 to 10
+ */
+static int vlu_encoded_size_64(uint64_t num)
+{
+    return (num >> 56) ? 8 + vlu_encoded_size_56(num >> 56)
+                       : vlu_encoded_size_56(num);
+}
 
-    for (; i < l; ) {
-        uint64_t d = 0;
-        size_t s = std::min((size_t)8,l-i);
-        std::memcpy(&d, &src[i], s);
-        vlu_result r = vlu_decode_56(d);
-        assert(r.shamt > 0);
-        assert(o < items);
-        dst[o] = r.val;
-        i += r.shamt;
-        o++;
-    }
+/*
+ * vlu_encode_64 - VLU8 encoding of full 64-bit values
+ *
+ * returns {
+ *   lo, hi: first and second 64-bit intervals
+ *   shamt:  packet size from 1 to 10
+ * }
+ */
+static vlu_result_112 vlu_encode_64(uint64_t num)
+{
+    vlu_result r = vlu_encode_56(num);
+    if (r.shamt > 0) return vlu_result_112{ r.val, 0, r.shamt };
+    vlu_result t = vlu_encode_56(num >> 56);
+    return vlu_result_112{ r.val, t.val, 8 + t.shamt };
 }
-#else
-static void vlu_decode_vec(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+
+/*
+ * vlu_decode_64 - VLU8 decoding of full 64-bit values
+ *
+ * The second interval is only used if the first is a continuation.
+ * Its terminal packet holds the top 8 bits so it is 1 or 2 bytes, and
+ * its size is a single bit test, keeping the serial dependency on the
+ * packet size short.
+ *
+ * returns {
+ *   val:   decoded value
+ *   shamt: packet size from 1 to 10
+ * }
+ */
+static vlu_result vlu_decode_64(uint64_t lo, uint64_t hi)
 {
-    ptrdiff_t l = src.size();
+    vlu_result r = vlu_decode_56(lo);
+    if (r.shamt > 0) return r;
+    int64_t shamt = 1 + (hi & 1);
+    uint64_t top = (hi >> shamt) & ~(~0ull << (7 * shamt));
+    return vlu_result{ r.val | (top << 56), 8 + shamt };
+}
 
-    uint64_t lo = 0, hi;
 
-    size_t items = vlu_items_vec(src);
-    dst.resize(items);
+/*
+ * Compile time encoding
+ *
+ * C++11 constexpr versions of the VLU8 packet functions, so that
+ * encoded constants and tables are computed by the compiler. They
+ * give the same results as the runtime versions, which remain the
+ * ones to use on data.
+ */
 
-    size_t s = std::min((size_t)8, (size_t)l);
-    switch (s) {
-    case 0: hi = 0; break;
-    case 8: hi = *reinterpret_cast<uint64_t*>(&src[0]); break;
-    default: hi = 0; std::memcpy(&hi, &src[0], s); break;
-    }
+static constexpr int vlu_const_shamt_56(int t1, uint64_t limit)
+{
+    return t1 >= (int)limit ? (int)limit : t1 + 1;
+}
 
-    size_t o = 0;
-    for (ptrdiff_t i = 0, j = i - 8; i < l;) {
+/*
+ * vlu_const_encoded_size_56 - VLU8 packet size in bytes
+ */
+static constexpr int vlu_const_encoded_size_56(uint64_t num, uint64_t limit = 8)
+{
+    return num == 0 ? 1 : vlu_const_shamt_56(8 - (const_clz(num) - 1) / 7, limit);
+}
+
+/*
+ * vlu_const_encoded_size_64 - VLU8 packet size in bytes for 64-bit values
+ */
+static constexpr int vlu_const_encoded_size_64(uint64_t num)
+{
+    return (num >> 56) ? 8 + vlu_const_encoded_size_56(num >> 56)
+                       : vlu_const_encoded_size_56(num);
+}
+
+static constexpr vlu_result vlu_const_encode_56_r(uint64_t num, uint64_t limit, int t1)
+{
+    return vlu_result{
+        (num << vlu_const_shamt_56(t1, limit))
+            | ((1ull << (vlu_const_shamt_56(t1, limit) - 1)) - 1)
+            | ((uint64_t)(t1 >= (int)limit) << (limit - 1)),
+        vlu_const_shamt_56(t1, limit) | -(int64_t)(t1 >= (int)limit) };
+}
+
+/*
+ * vlu_const_encode_56 - VLU8 encoding with continuation support
+ */
+static constexpr vlu_result vlu_const_encode_56(uint64_t num, uint64_t limit = 8)
+{
+    return num == 0 ? vlu_result{ 0, 1 }
+        : vlu_const_encode_56_r(num, limit, 8 - (const_clz(num) - 1) / 7);
+}
+
+static constexpr vlu_result vlu_const_decode_56_r(uint64_t vlu, uint64_t limit, int t1)
+{
+    return vlu_result{
+        (vlu >> vlu_const_shamt_56(t1, limit)) & (t1 >= (int)limit ? ~0ull
+            : ~(~0ull << (vlu_const_shamt_56(t1, limit) * 7))),
+        vlu_const_shamt_56(t1, limit) | -(int64_t)(t1 >= (int)limit) };
+}
+
+/*
+ * vlu_const_decode_56 - VLU8 decoding with continuation support
+ */
+static constexpr vlu_result vlu_const_decode_56(uint64_t vlu, uint64_t limit = 8)
+{
+    return vlu_const_decode_56_r(vlu, limit, const_ctz(~vlu | (1ull << limit)));
+}
+
+/*
+ * vlu_const_byte_64 - byte k of the packed encoding of a 64-bit value
+ */
+static constexpr uint8_t vlu_const_byte_64(uint64_t num, size_t k)
+{
+    return k < 8 ? uint8_t(vlu_const_encode_56(num).val >> (k << 3))
+                 : uint8_t(vlu_const_encode_56(num >> 56).val >> ((k - 8) << 3));
+}
+
+template <size_t... I> struct vlu_indices {};
+template <size_t N, size_t... I> struct vlu_make_indices : vlu_make_indices<N - 1, N - 1, I...> {};
+template <size_t... I> struct vlu_make_indices<0, I...> { typedef vlu_indices<I...> type; };
+
+/*
+ * vlu_literal - packed encoding of N as a constant array
+ *
+ * e.g. vlu_literal<300>::value is { 0xb1, 0x04 }, and
+ * vlu_literal<300>::size is 2.
+ */
+template <uint64_t N>
+struct vlu_literal
+{
+    static constexpr size_t size = vlu_const_encoded_size_64(N);
+    typedef std::array<uint8_t, size> array_type;
+
+    template <size_t... I>
+    static constexpr array_type make(vlu_indices<I...>)
+    {
+        return array_type{{ vlu_const_byte_64(N, I)... }};
+    }
+
+    static constexpr array_type value = make(typename vlu_make_indices<size>::type());
+};
+
+template <uint64_t N> constexpr size_t vlu_literal<N>::size;
+template <uint64_t N> constexpr typename vlu_literal<N>::array_type vlu_literal<N>::value;
+
+
+/*
+ * Signed values
+ *
+ * Signed values are zigzag mapped to unsigned values before encoding
+ * so that small magnitudes of either sign have short packets:
+ *
+ *   0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...
+ */
+
+struct svlu_result
+{
+    int64_t val;
+    int64_t shamt;
+};
+
+/*
+ * svlu_zigzag - map signed value to unsigned value
+ */
+static uint64_t svlu_zigzag(int64_t num)
+{
+    return ((uint64_t)num << 1) ^ (uint64_t)(num >> 63);
+}
+
+/*
+ * svlu_unzigzag - map unsigned value to signed value
+ */
+static int64_t svlu_unzigzag(uint64_t num)
+{
+    return (int64_t)(num >> 1) ^ -(int64_t)(num & 1);
+}
+
+/*
+ * svlu_encoded_size_64 - signed VLU8 packet size in bytes, from 1 to 10
+ */
+static int svlu_encoded_size_64(int64_t num)
+{
+    return vlu_encoded_size_64(svlu_zigzag(num));
+}
+
+/*
+ * svlu_encode_56 - signed VLU8 encoding for -2^55 to 2^55-1
+ */
+static vlu_result svlu_encode_56(int64_t num)
+{
+    return vlu_encode_56(svlu_zigzag(num));
+}
+
+/*
+ * svlu_decode_56 - signed VLU8 decoding for -2^55 to 2^55-1
+ */
+static svlu_result svlu_decode_56(uint64_t vlu)
+{
+    vlu_result r = vlu_decode_56(vlu);
+    return svlu_result{ svlu_unzigzag(r.val), r.shamt };
+}
+
+/*
+ * svlu_encode_64 - signed VLU8 encoding of full 64-bit values
+ */
+static vlu_result_112 svlu_encode_64(int64_t num)
+{
+    return vlu_encode_64(svlu_zigzag(num));
+}
+
+/*
+ * svlu_decode_64 - signed VLU8 decoding of full 64-bit values
+ */
+static svlu_result svlu_decode_64(uint64_t lo, uint64_t hi)
+{
+    vlu_result r = vlu_decode_64(lo, hi);
+    return svlu_result{ svlu_unzigzag(r.val), r.shamt };
+}
+
+/*
+ * vlu_skip_scalar - byte offset after n more values from offset i
+ *
+ * Only the packet sizes are decoded. Stops before a value that is cut
+ * short by the end of the buffer. Must start on a packet boundary.
+ */
+static size_t vlu_skip_scalar(const uint8_t *s, size_t l, size_t i, size_t n)
+{
+    size_t v = i;
+    while (n > 0 && i < l) {
+        uint64_t d = 0;
+        if (i + 8 <= l) {
+            std::memcpy(&d, s + i, 8);
+        } else {
+            std::memcpy(&d, s + i, l - i);
+        }
+        size_t shamt = vlu_decoded_size_56(d);
+        if (i + shamt > l) break;
+        i += shamt;
+        if ((d & 0xff) != 0xff) {
+            n--;
+            v = i;
+        }
+    }
+    return v;
+}
+
+#if USE_AVX2
+
+/*
+ * vlu_lengths_16 - VLU8 packet size for each of 16 bytes
+ *
+ * Every byte is classified as if it were the first byte of a packet.
+ * The low nibble lookup yields ctz(~nibble) + 1, or 8 for 0b1111 so
+ * that the high nibble lookup, 5 to 8, is selected by unsigned min.
+ */
+VLU_TARGET_AVX2
+static inline __m128i vlu_lengths_16(const uint8_t *p)
+{
+    const __m128i lo_lut = _mm_setr_epi8(1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,8);
+    const __m128i hi_lut = _mm_setr_epi8(5,6,5,7,5,6,5,8,5,6,5,7,5,6,5,8);
+    const __m128i m4 = _mm_set1_epi8(0x0f);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i lo = _mm_shuffle_epi8(lo_lut, _mm_and_si128(v, m4));
+    __m128i hi = _mm_shuffle_epi8(hi_lut, _mm_and_si128(_mm_srli_epi16(v, 4), m4));
+    return _mm_min_epu8(lo, hi);
+}
+
+/*
+ * vlu_lengths_32 - VLU8 packet size for each of 32 bytes
+ */
+VLU_TARGET_AVX2
+static inline __m256i vlu_lengths_32(const uint8_t *p)
+{
+    const __m256i lo_lut = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,8));
+    const __m256i hi_lut = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(5,6,5,7,5,6,5,8,5,6,5,7,5,6,5,8));
+    const __m256i m4 = _mm256_set1_epi8(0x0f);
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i lo = _mm256_shuffle_epi8(lo_lut, _mm256_and_si256(v, m4));
+    __m256i hi = _mm256_shuffle_epi8(hi_lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), m4));
+    return _mm256_min_epu8(lo, hi);
+}
+
+/*
+ * vlu_nibbles_16 - pack 16 bytes with values below 16 into 64-bits
+ */
+VLU_TARGET_AVX2
+static inline uint64_t vlu_nibbles_16(__m128i x)
+{
+    __m128i w = _mm_maddubs_epi16(x, _mm_set1_epi16(0x1001));
+    return (uint64_t)_mm_cvtsi128_si64(_mm_packus_epi16(w, w));
+}
+
+/*
+ * vlu_items_avx2 - get size of array using pointer doubling
+ *
+ * Each byte lane holds the position of the next packet if a packet
+ * were to start at that byte. Four rounds of pshufb double the jumps
+ * within each 16-byte half and accumulate counts, after which lane i
+ * holds the number of packets starting in the half when entering at
+ * byte i, and the position of the first packet in the following half.
+ * Only the entry offset is carried serially from block to block.
+ * Continuation intervals start with 0xff and count as zero.
+ *
+ * vlu_doubling_32 computes the counts and next positions for a block.
+ */
+VLU_TARGET_AVX2
+static inline void vlu_doubling_32(const uint8_t *p, uint8_t *cnt, uint8_t *nxt)
+{
+    const __m256i iota = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15));
+    const __m256i ovf = _mm256_set1_epi8(0x70);
+
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i n = _mm256_add_epi8(iota, vlu_lengths_32(p));
+    __m256i c = _mm256_add_epi8(_mm256_set1_epi8(1),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(-1)));
+    for (size_t r = 0; r < 4; r++) {
+        /* lanes jumping out of the half select zero */
+        __m256i k = _mm256_adds_epu8(n, ovf);
+        c = _mm256_add_epi8(c, _mm256_shuffle_epi8(c, k));
+        n = _mm256_max_epu8(n, _mm256_shuffle_epi8(n, k));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(cnt), c);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(nxt), n);
+}
+
+VLU_TARGET_AVX2
+static size_t vlu_items_avx2(const uint8_t *s, size_t l)
+{
+    alignas(32) uint8_t cnt[32], nxt[32];
+
+    size_t items = 0, b = 0, q = 0;
+    for (; b + 32 <= l; b += 32) {
+        vlu_doubling_32(s + b, cnt, nxt);
+        items += cnt[q];
+        q = nxt[q] - 16;
+        items += cnt[q + 16];
+        q = nxt[q + 16] - 16;
+    }
+
+    for (size_t i = b + q; i < l; ) {
+        uint64_t d = 0;
+        std::memcpy(&d, s + i, std::min((size_t)8,l-i));
+        size_t shamt = vlu_decoded_size_56(d);
+        assert(shamt > 0 && shamt < 9);
+        i += shamt;
+        items += (d & 0xff) != 0xff;
+    }
+    return items;
+}
+
+/*
+ * vlu_skip_avx2 - byte offset after n values using pointer doubling
+ *
+ * Whole 16-byte halves are skipped while they hold fewer values than
+ * remain, using the counts from vlu_doubling_32, and the last values
+ * are stepped over with the scalar kernel. The entry into a half may
+ * be the terminal packet of a value whose continuation interval was
+ * skipped, so at least one value is always left to the scalar kernel,
+ * and 16 bytes of slack keep that terminal inside the buffer.
+ */
+VLU_TARGET_AVX2
+static size_t vlu_skip_avx2(const uint8_t *s, size_t l, size_t n)
+{
+    alignas(32) uint8_t cnt[32], nxt[32];
+
+    size_t b = 0, q = 0;
+    for (; b + 48 <= l; b += 32) {
+        vlu_doubling_32(s + b, cnt, nxt);
+        if (n <= cnt[q]) break;
+        n -= cnt[q];
+        q = nxt[q] - 16;
+        if (n <= cnt[q + 16]) {
+            q += 16;
+            break;
+        }
+        n -= cnt[q + 16];
+        q = nxt[q + 16] - 16;
+    }
+
+    return vlu_skip_scalar(s, l, b + q, n);
+}
+#endif
+
+#if USE_AVX512_VBMI2
+VLU_AVX512_BEGIN
+
+/*
+ * vlu_lengths_64 - VLU8 packet size for each of 64 bytes
+ */
+VLU_TARGET_AVX512
+static inline __m512i vlu_lengths_64(__m512i v)
+{
+    /* bytes 1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,8 and 5,6,5,7,5,6,5,8,... */
+    const __m512i lo_lut = _mm512_set4_epi32(0x08010201, 0x03010201, 0x04010201, 0x03010201);
+    const __m512i hi_lut = _mm512_set4_epi32(0x08050605, 0x07050605, 0x08050605, 0x07050605);
+    const __m512i m4 = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_shuffle_epi8(lo_lut, _mm512_and_si512(v, m4));
+    __m512i hi = _mm512_shuffle_epi8(hi_lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), m4));
+    return _mm512_min_epu8(lo, hi);
+}
+
+VLU_TARGET_AVX512
+static inline __m512i vlu_iota_64()
+{
+    return _mm512_set_epi64(
+        0x3f3e3d3c3b3a3938, 0x3736353433323130, 0x2f2e2d2c2b2a2928, 0x2726252423222120,
+        0x1f1e1d1c1b1a1918, 0x1716151413121110, 0x0f0e0d0c0b0a0908, 0x0706050403020100);
+}
+
+/*
+ * vlu_items_avx512 - get size of array using pointer doubling
+ *
+ * Each byte lane holds the position of the next packet if a packet
+ * were to start at that byte. Six rounds of vpermb double the jumps
+ * and accumulate counts, after which lane i holds the number of
+ * packets starting in the 64-byte block when entering at byte i, and
+ * the position of the first packet in the following block.
+ */
+VLU_TARGET_AVX512
+static inline void vlu_doubling_64(const uint8_t *p, uint8_t *cnt, uint8_t *nxt)
+{
+    const __m512i iota = vlu_iota_64();
+    const __m512i c64 = _mm512_set1_epi8(64);
+
+    __m512i v = _mm512_loadu_si512(p);
+    __m512i n = _mm512_add_epi8(iota, vlu_lengths_64(v));
+    /* continuation intervals count as zero */
+    __m512i c = _mm512_maskz_mov_epi8(
+        _mm512_cmpneq_epi8_mask(v, _mm512_set1_epi8(-1)), _mm512_set1_epi8(1));
+    for (size_t r = 0; r < 6; r++) {
+        __mmask64 k = _mm512_cmplt_epu8_mask(n, c64);
+        c = _mm512_mask_add_epi8(c, k, c, _mm512_permutexvar_epi8(n, c));
+        n = _mm512_mask_permutexvar_epi8(n, k, n, n);
+    }
+    _mm512_store_si512(cnt, c);
+    _mm512_store_si512(nxt, n);
+}
+
+VLU_TARGET_AVX512
+static size_t vlu_items_avx512(const uint8_t *s, size_t l)
+{
+    alignas(64) uint8_t cnt[64], nxt[64];
+
+    size_t items = 0, b = 0, q = 0;
+    for (; b + 64 <= l; b += 64) {
+        vlu_doubling_64(s + b, cnt, nxt);
+        items += cnt[q];
+        q = nxt[q] - 64;
+    }
+
+    for (size_t i = b + q; i < l; ) {
+        uint64_t d = 0;
+        std::memcpy(&d, s + i, std::min((size_t)8,l-i));
+        size_t shamt = vlu_decoded_size_56(d);
+        assert(shamt > 0 && shamt < 9);
+        i += shamt;
+        items += (d & 0xff) != 0xff;
+    }
+    return items;
+}
+
+/*
+ * vlu_skip_avx512 - byte offset after n values using pointer doubling
+ *
+ * Same as vlu_skip_avx2 with 64-byte blocks from vlu_doubling_64.
+ */
+VLU_TARGET_AVX512
+static size_t vlu_skip_avx512(const uint8_t *s, size_t l, size_t n)
+{
+    alignas(64) uint8_t cnt[64], nxt[64];
+
+    size_t b = 0, q = 0;
+    for (; b + 80 <= l; b += 64) {
+        vlu_doubling_64(s + b, cnt, nxt);
+        if (n <= cnt[q]) break;
+        n -= cnt[q];
+        q = nxt[q] - 64;
+    }
+
+    return vlu_skip_scalar(s, l, b + q, n);
+}
+VLU_AVX512_END
+#endif
+
+/*
+ * vlu_encode_bound - worst case packed size in bytes
+ */
+static size_t vlu_encode_bound(size_t n)
+{
+    return n * 10;
+}
+
+/*
+ * vlu_size - calculate packed size in bytes
+ */
+static size_t vlu_size(const uint64_t *src, size_t n)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t shamt = vlu_encoded_size_64(src[i]);
+        assert(shamt > 0 && shamt < 11);
+        len += shamt;
+    }
+    return len;
+}
+
+/*
+ * vlu_items - get number of values in buffer
+ *
+ * Continuation intervals are stepped over without being counted.
+ */
+#if USE_UNALIGNED_ACCESSES
+static size_t vlu_items_scalar(const uint8_t *src, size_t len)
+{
+    size_t items = 0;
+    for (size_t i = 0 ; i < len;) {
+        uint64_t d = 0;
+        size_t s = std::min((size_t)8,len-i);
+        switch (s) {
+        case 1: d = *reinterpret_cast<const uint8_t*>(src + i); break;
+        case 2: d = *reinterpret_cast<const uint16_t*>(src + i); break;
+        case 3: std::memcpy(&d, src + i, s); break;
+        case 4: d = *reinterpret_cast<const uint32_t*>(src + i); break;
+        case 5: case 6: case 7: std::memcpy(&d, src + i, s); break;
+        case 8: d = *reinterpret_cast<const uint64_t*>(src + i); break;
+        default: std::memcpy(&d, src + i, s); break;
+        }
+        size_t shamt = vlu_decoded_size_56(d);
+        assert(shamt > 0 && shamt < 9);
+        i += shamt;
+        items += (d & 0xff) != 0xff;
+    }
+    return items;
+}
+#else
+static size_t vlu_items_scalar(const uint8_t *src, size_t len)
+{
+    size_t items = 0;
+    ptrdiff_t l = len;
+
+    ptrdiff_t shamt = 8;
+    uint64_t lo = 0, hi = 0;
+
+    std::memcpy(&hi, src, std::min((size_t)8, len));
+
+    for (ptrdiff_t i = 0, j = i - shamt; i < l;) {
 
         if ((i>>3) > (j>>3)) {
             ptrdiff_t x = (i&~7)+8;
             lo = hi;
-            size_t s = std::max((ptrdiff_t)0,std::min((ptrdiff_t)8, l-x));
-            switch (s) {
-            case 0: hi = 0; break;
-            case 8: hi = *reinterpret_cast<uint64_t*>(&src[x]); break;
-            default: hi = 0; std::memcpy(&hi, &src[x], s); break;
+            hi = 0;
+            if (x < l) {
+                std::memcpy(&hi, src + x, std::min((ptrdiff_t)8, l-x));
+            }
+        }
+        size_t y = (i&7)<<3;
+        uint64_t data = y == 0 ? lo : (lo >> y) | (hi << (64 - y));
+
+        shamt = vlu_decoded_size_56(data);
+        assert(shamt > 0 && shamt < 9);
+
+        items += (data & 0xff) != 0xff;
+        j = i;
+        i += shamt;
+    }
+
+    return items;
+}
+#endif
+
+static size_t vlu_items(const uint8_t *src, size_t len)
+{
+#if USE_AVX512_VBMI2
+    if (vlu_cpu_avx512vbmi2()) return vlu_items_avx512(src, len);
+#endif
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_items_avx2(src, len);
+#endif
+    return vlu_items_scalar(src, len);
+}
+
+/*
+ * vlu_map_unsigned, vlu_map_zigzag - value maps for the bulk kernels
+ *
+ * The scalar encode and decode kernels apply a map to each value as
+ * it is packed or unpacked so that signed arrays need no separate
+ * pass. The SIMD kernels take plain values and the map is applied in
+ * blocks around them. The encode side is given the array and index so
+ * that a map can refer to preceding values.
+ */
+struct vlu_map_unsigned
+{
+    typedef uint64_t type;
+    uint64_t enc(const uint64_t *src, size_t i) const { return src[i]; }
+    uint64_t dec(uint64_t num) const { return num; }
+};
+
+struct vlu_map_zigzag
+{
+    typedef int64_t type;
+    uint64_t enc(const int64_t *src, size_t i) const { return svlu_zigzag(src[i]); }
+    int64_t dec(uint64_t num) const { return svlu_unzigzag(num); }
+};
+
+/*
+ * vlu_map_delta - difference from the preceding value
+ *
+ * prev is the value preceding the array.
+ */
+struct vlu_map_delta
+{
+    typedef uint64_t type;
+    uint64_t prev;
+    uint64_t enc(const uint64_t *src, size_t i) const
+    {
+        return src[i] - (i > 0 ? src[i-1] : prev);
+    }
+};
+
+/*
+ * vlu_map_base - difference from a block base
+ */
+struct vlu_map_base
+{
+    typedef uint64_t type;
+    uint64_t base;
+    uint64_t enc(const uint64_t *src, size_t i) const { return src[i] - base; }
+};
+
+/*
+ * vlu_map_dod - zigzag difference from the preceding difference
+ *
+ * prev is the value preceding the array and delta is the difference
+ * between it and the value before it.
+ */
+struct vlu_map_dod
+{
+    typedef uint64_t type;
+    uint64_t prev;
+    uint64_t delta;
+    uint64_t enc(const uint64_t *src, size_t i) const
+    {
+        uint64_t p1 = i > 0 ? src[i-1] : prev;
+        uint64_t d1 = i > 1 ? src[i-1] - src[i-2] : i > 0 ? src[0] - prev : delta;
+        return svlu_zigzag((int64_t)(src[i] - p1 - d1));
+    }
+};
+
+/*
+ * vlu_encode - encode array into buffer
+ *
+ * Encodes values until the next packet does not fit in the buffer.
+ * Packets are written with full word stores while at least 16 bytes
+ * of space remain, so sizing the buffer with vlu_encode_bound keeps
+ * all but the last few packets on the fast path. Values above 56 bits
+ * take a second store for the terminal packet.
+ *
+ * returns {
+ *   nread:    number of values encoded
+ *   nwritten: number of bytes written
+ * }
+ */
+#if USE_UNALIGNED_ACCESSES
+template <typename M>
+static vlu_io_result vlu_encode_map(uint8_t *dst, size_t cap, const typename M::type *src, size_t n, const M &m)
+{
+    size_t i = 0, o = 0;
+
+    for (; i < n && o + 16 <= cap; i++) {
+        uint64_t num = m.enc(src, i);
+        vlu_result r = vlu_encode_56(num);
+        *reinterpret_cast<uint64_t*>(dst + o) = r.val;
+        if (r.shamt < 0) {
+            r = vlu_encode_56(num >> 56);
+            *reinterpret_cast<uint64_t*>(dst + o + 8) = r.val;
+            o += 8;
+        }
+        assert(r.shamt > 0 && r.shamt < 9);
+        o += r.shamt;
+    }
+
+    for (; i < n; i++) {
+        vlu_result_112 r = vlu_encode_64(m.enc(src, i));
+        assert(r.shamt > 0 && r.shamt < 11);
+        if (o + r.shamt > cap) break;
+        uint8_t w[16];
+        std::memcpy(w, &r.lo, 8);
+        std::memcpy(w + 8, &r.hi, 8);
+        std::memcpy(dst + o, w, r.shamt);
+        o += r.shamt;
+    }
+
+    return vlu_io_result{ i, o };
+}
+#else
+template <typename M>
+static vlu_io_result vlu_encode_map(uint8_t *dst, size_t cap, const typename M::type *src, size_t n, const M &m)
+{
+    uint64_t lo = 0, hi = 0;
+
+    size_t i = 0, j = 0, k = 0;
+    for (; k < n; k++) {
+        vlu_result_112 e = vlu_encode_64(m.enc(src, k));
+        assert(e.shamt > 0 && e.shamt < 11);
+        if (i + e.shamt > cap) break;
+
+        /* one packet, or a continuation interval and terminal packet */
+        uint64_t val[2] = { e.lo, e.hi };
+        size_t shamt[2] = { e.shamt > 8 ? 8 : (size_t)e.shamt, e.shamt > 8 ? (size_t)e.shamt - 8 : 0 };
+        for (size_t p = 0; p < 1 + (e.shamt > 8); p++) {
+            size_t y = (i&7)<<3;
+            if (y == 0) {
+                lo = val[p];
+            } else {
+                lo |= (val[p] << y);
+                hi |= (val[p] >> (64 - y));
+            }
+
+            j = i;
+            i += shamt[p];
+
+            if ((i>>3) > (j>>3)) {
+                std::memcpy(dst + (i&~7) - 8, &lo, 8);
+                lo = hi;
+                hi = 0;
+            }
+        }
+    }
+
+    if (i & 7) {
+        std::memcpy(dst + (i&~7), &lo, i & 7);
+    }
+
+    return vlu_io_result{ k, i };
+}
+#endif
+
+static vlu_io_result vlu_encode(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+    return vlu_encode_map(dst, cap, src, n, vlu_map_unsigned());
+}
+
+/*
+ * vlu_decode - decode buffer into array
+ *
+ * Decodes packets until the array is full or the buffer is exhausted,
+ * stopping before a packet that is cut short by the end of the buffer.
+ *
+ * returns {
+ *   nread:    number of bytes consumed
+ *   nwritten: number of values decoded
+ * }
+ */
+#if USE_UNALIGNED_ACCESSES
+template <typename M, typename S = vlu_step_scalar>
+static vlu_io_result vlu_decode_map(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+    size_t i = 0, o = 0;
+
+    for (; i + 8 <= len && o < cap; )  {
+        uint64_t d = *reinterpret_cast<const uint64_t*>(src + i);
+        vlu_result r = S::decode_56(d);
+        if (r.shamt < 0) {
+            if (i + 16 > len) break;
+            r = vlu_decode_64(d, *reinterpret_cast<const uint64_t*>(src + i + 8));
+        }
+        assert(r.shamt > 0);
+        dst[o] = m.dec(r.val);
+        i += r.shamt;
+        o++;
+    }
+
+    for (; i < len && o < cap; ) {
+        uint8_t w[16] = { 0 };
+        size_t s = std::min((size_t)16,len-i);
+        std::memcpy(w, src + i, s);
+        uint64_t lo, hi;
+        std::memcpy(&lo, w, 8);
+        std::memcpy(&hi, w + 8, 8);
+        vlu_result r = vlu_decode_64(lo, hi);
+        assert(r.shamt > 0);
+        if ((size_t)r.shamt > s) break;
+        dst[o] = m.dec(r.val);
+        i += r.shamt;
+        o++;
+    }
+
+    return vlu_io_result{ i, o };
+}
+#else
+template <typename M, typename S = vlu_step_scalar>
+static vlu_io_result vlu_decode_map(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+    ptrdiff_t l = len;
+
+    uint64_t lo = 0, hi = 0;
+
+    std::memcpy(&hi, src, std::min((size_t)8, len));
+
+    size_t o = 0;
+    ptrdiff_t i = 0;
+    for (ptrdiff_t j = i - 8; i < l && o < cap;) {
+
+        if ((i>>3) > (j>>3)) {
+            ptrdiff_t x = (i&~7)+8;
+            /* a continuation may skip a whole word */
+            if ((i>>3) > (j>>3) + 1) {
+                hi = 0;
+                std::memcpy(&hi, src + x - 8, std::min((ptrdiff_t)8, l-x+8));
+            }
+            lo = hi;
+            hi = 0;
+            if (x < l) {
+                std::memcpy(&hi, src + x, std::min((ptrdiff_t)8, l-x));
+            }
+        }
+        size_t y = (i&7)<<3;
+        uint64_t data = y == 0 ? lo : (lo >> y) | (hi << (64 - y));
+
+        vlu_result r = S::decode_56(data);
+        if (r.shamt < 0) {
+            uint64_t t = 0;
+            if (i + 8 < l) {
+                std::memcpy(&t, src + i + 8, std::min((ptrdiff_t)8, l-i-8));
+            }
+            r = vlu_decode_64(data, t);
+        }
+        assert(r.shamt > 0);
+        if (i + r.shamt > l) break;
+        dst[o] = m.dec(r.val);
+
+        j = i;
+        i += r.shamt;
+        o++;
+    }
+
+    return vlu_io_result{ (size_t)i, o };
+}
+#endif
+
+#if VLU_ASM_BMI2
+template <typename M>
+VLU_TARGET_BMI2
+static vlu_io_result vlu_decode_map_bmi2(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+    return vlu_decode_map<M, vlu_step_bmi2>(dst, cap, src, len, m);
+}
+#endif
+
+static vlu_io_result vlu_decode(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if VLU_ASM_BMI2
+    if (vlu_cpu_bmi2()) return vlu_decode_map_bmi2(dst, cap, src, len, vlu_map_unsigned());
+#endif
+    return vlu_decode_map(dst, cap, src, len, vlu_map_unsigned());
+}
+
+#if USE_AVX2
+
+/*
+ * vlu_pair_table - shuffle and shift vectors for pairs of VLU8 packets
+ *
+ * Indexed by ((len1 - 1) << 3) | (len2 - 1), the shuffle moves two
+ * adjacent packets at the start of a 16-byte window into the low bytes
+ * of separate 64-bit lanes, zero filling above each packet, so that a
+ * variable right shift by the packet length strips the unary prefix.
+ */
+struct vlu_pair_table
+{
+    alignas(16) uint8_t shuf[64][16];
+    alignas(16) uint64_t shift[64][2];
+
+    vlu_pair_table()
+    {
+        for (size_t l1 = 1; l1 <= 8; l1++) {
+            for (size_t l2 = 1; l2 <= 8; l2++) {
+                size_t k = ((l1 - 1) << 3) | (l2 - 1);
+                for (size_t j = 0; j < 8; j++) {
+                    shuf[k][j] = j < l1 ? (uint8_t)j : 0x80;
+                    shuf[k][j + 8] = j < l2 ? (uint8_t)(l1 + j) : 0x80;
+                }
+                shift[k][0] = l1;
+                shift[k][1] = l2;
+            }
+        }
+    }
+};
+
+static const vlu_pair_table& vlu_get_pair_table()
+{
+    static const vlu_pair_table table;
+    return table;
+}
+
+/*
+ * vlu_decode_avx2 - decode buffer into array using pair shuffles
+ *
+ * Packet sizes are classified for a whole 16-byte block at a time, and
+ * the size of the packet following each byte is gathered with a second
+ * shuffle, giving the size of every packet pair in the block as nibbles.
+ * The serial dependency is then one shift and add per pair, and each
+ * pair is unpacked with one pshufb and one variable shift.
+ */
+VLU_TARGET_AVX2
+static vlu_io_result vlu_decode_avx2(uint64_t *d, size_t cap, const uint8_t *s, size_t l)
+{
+    const vlu_pair_table &t = vlu_get_pair_table();
+    const __m128i iota = _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    const __m128i one = _mm_set1_epi8(1), sixteen = _mm_set1_epi8(16);
+    const __m128i ovf = _mm_set1_epi8(0x70), ff = _mm_set1_epi8(-1);
+
+    size_t b = 0, q = 0, o = 0;
+
+    /* a block yields at most 16 packets plus one trailing pair member */
+    __m128i len0 = l >= 16 ? vlu_lengths_16(s) : _mm_setzero_si128();
+    uint64_t ff0 = l >= 16 ? (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), ff)) : 0;
+    for (; b + 32 <= l && o + 18 <= cap; b += 16) {
+        __m128i len1 = vlu_lengths_16(s + b + 16);
+        uint64_t ff1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + b + 16)), ff));
+        uint64_t fm = ff0 | (ff1 << 16);
+        /* size of the following packet, from this block or the next */
+        __m128i next = _mm_add_epi8(iota, len0);
+        __m128i len2 = _mm_or_si128(
+            _mm_shuffle_epi8(len0, _mm_adds_epu8(next, ovf)),
+            _mm_shuffle_epi8(len1, _mm_sub_epi8(next, sixteen)));
+        uint64_t pn = vlu_nibbles_16(_mm_sub_epi8(_mm_add_epi8(len0, len2), one));
+        uint64_t ln = vlu_nibbles_16(len0);
+        while (q < 16) {
+            size_t sh = q << 2;
+            size_t pl = ((pn >> sh) & 15) + 1;
+            size_t l1 = (ln >> sh) & 15;
+            if (((fm >> q) | (fm >> (q + l1))) & 1) {
+                /* continuation interval, decode one value with the scalar kernel */
+                vlu_io_result r = vlu_decode(d + o, 1, s + b + q, l - b - q);
+                assert(r.nwritten == 1);
+                o += 1;
+                q += r.nread;
+                continue;
+            }
+            size_t k = l1 * 7 + pl - 9;
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + b + q));
+            x = _mm_shuffle_epi8(x, _mm_load_si128(reinterpret_cast<const __m128i*>(t.shuf[k])));
+            x = _mm_srlv_epi64(x, _mm_load_si128(reinterpret_cast<const __m128i*>(t.shift[k])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + o), x);
+            o += 2;
+            q += pl;
+        }
+        q -= 16;
+        len0 = len1;
+        ff0 = ff1;
+    }
+
+    size_t i = std::min(b + q, l);
+    vlu_io_result r = vlu_decode(d + o, cap - o, s + i, l - i);
+    return vlu_io_result{ i + r.nread, o + r.nwritten };
+}
+
+/*
+ * vlu_decode_vec_avx2 - decode array using pair shuffles
+ */
+VLU_TARGET_AVX2
+static void vlu_decode_vec_avx2(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_avx2(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
+}
+#endif
+
+#if USE_AVX512_VBMI2
+VLU_AVX512_BEGIN
+
+/*
+ * vlu_decode_avx512 - decode buffer into array using byte expand
+ *
+ * The doubled jump vectors are used to walk the positions of all the
+ * packets starting in a 64-byte block, in lane order, from the entry
+ * position. The sizes of eight consecutive packets then form a byte
+ * mask that vpexpandb uses to scatter their bytes into 64-bit lanes,
+ * and a variable shift strips the unary prefixes.
+ */
+VLU_TARGET_AVX512
+static vlu_io_result vlu_decode_avx512(uint64_t *d, size_t cap, const uint8_t *s, size_t l)
+{
+    const __m512i iota = vlu_iota_64();
+    const __m512i c64 = _mm512_set1_epi8(64);
+    /* bytes 0,1,3,7,15,31,63,127,255,0,0,0,0,0,0,0 */
+    const __m512i mask_lut = _mm512_set4_epi32(0, 0xff, 0x7f3f1f0f, 0x07030100);
+    alignas(64) uint8_t pos[64], len[64], msk[64];
+
+    size_t b = 0, q = 0, o = 0;
+
+    /* packets starting in the block may run up to 9 bytes past it */
+    for (; b + 73 <= l && o + 64 <= cap; b += 64) {
+        __m512i blk = _mm512_loadu_si512(s + b);
+        __m512i n = vlu_lengths_64(blk);
+        __m512i j = _mm512_add_epi8(iota, n);
+        /* lane m walks to the position of the m-th packet */
+        __m512i x = _mm512_set1_epi8((char)q);
+        for (size_t r = 0; r < 6; r++) {
+            __mmask64 sel = _mm512_test_epi8_mask(iota, _mm512_set1_epi8(1 << r));
+            __mmask64 xin = _mm512_cmplt_epu8_mask(x, c64);
+            __mmask64 jin = _mm512_cmplt_epu8_mask(j, c64);
+            x = _mm512_mask_permutexvar_epi8(x, sel & xin, x, j);
+            j = _mm512_mask_permutexvar_epi8(j, jin, j, j);
+        }
+        __mmask64 valid = _mm512_cmplt_epu8_mask(x, c64);
+        __mmask64 cont = _mm512_mask_cmpeq_epi8_mask(valid,
+            _mm512_permutexvar_epi8(x, blk), _mm512_set1_epi8(-1));
+        if (cont) {
+            /* continuation intervals, decode the block with the scalar kernel */
+            size_t i = b + q;
+            while (i < b + 64) {
+                vlu_io_result r = vlu_decode(d + o, 1, s + i, l - i);
+                assert(r.nwritten == 1);
+                i += r.nread;
+                o++;
+            }
+            q = i - b - 64;
+            continue;
+        }
+        size_t c = (size_t)_mm_popcnt_u64(valid);
+        __m512i lx = _mm512_maskz_permutexvar_epi8(valid, x, n);
+        _mm512_store_si512(pos, x);
+        _mm512_store_si512(len, lx);
+        _mm512_store_si512(msk, _mm512_shuffle_epi8(mask_lut, lx));
+        for (size_t g = 0; g < c; g += 8) {
+            uint64_t e;
+            std::memcpy(&e, msk + g, 8);
+            __mmask8 k = (__mmask8)(c - g >= 8 ? 0xff : (1u << (c - g)) - 1);
+            __m512i v = _mm512_maskz_expandloadu_epi8(e, s + b + pos[g]);
+            __m512i sh = _mm512_cvtepu8_epi64(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(len + g)));
+            _mm512_mask_storeu_epi64(d + o + g, k, _mm512_srlv_epi64(v, sh));
+        }
+        o += c;
+        q = pos[c - 1] + len[c - 1] - 64;
+    }
+
+    size_t i = b + q;
+    vlu_io_result r = vlu_decode(d + o, cap - o, s + i, l - i);
+    return vlu_io_result{ i + r.nread, o + r.nwritten };
+}
+
+/*
+ * vlu_decode_vec_avx512 - decode array using byte expand
+ */
+VLU_TARGET_AVX512
+static void vlu_decode_vec_avx512(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items_avx512(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_avx512(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * vlu_encode_avx512 - encode array into buffer using byte compress
+ *
+ * Eight values are encoded per step in 64-bit lanes, with the packet
+ * size computed from vplzcntq, and vpcompressb packs the low bytes of
+ * each lane into a contiguous run using a mask built from the sizes.
+ * Steps containing values above 56 bits use the scalar kernel.
+ */
+VLU_TARGET_AVX512
+static vlu_io_result vlu_encode_avx512(uint8_t *d, size_t cap, const uint64_t *s, size_t l)
+{
+    const __m512i one = _mm512_set1_epi64(1), eight = _mm512_set1_epi64(8);
+    /* bytes 0,1,3,7,15,31,63,127,255,0,0,0,0,0,0,0 */
+    const __m512i mask_lut = _mm512_set4_epi32(0, 0xff, 0x7f3f1f0f, 0x07030100);
+
+    size_t i = 0, o = 0;
+
+    for (; i + 8 <= l && o + 80 <= cap; i += 8) {
+        __m512i v = _mm512_loadu_si512(s + i);
+        __m512i lz = _mm512_lzcnt_epi64(v);
+        if (_mm512_cmplt_epu64_mask(lz, eight)) {
+            /* values above 56 bits take a continuation interval */
+            vlu_io_result r = vlu_encode(d + o, cap - o, s + i, 8);
+            assert(r.nread == 8);
+            o += r.nwritten;
+            continue;
+        }
+        /* t1 = 8 - (lz - 1) / 7, where (x * 37) >> 8 == x / 7 for x < 64 */
+        __m512i lz1 = _mm512_sub_epi64(lz, one);
+        __m512i t1 = _mm512_sub_epi64(eight, _mm512_srli_epi64(
+            _mm512_mullo_epi32(lz1, _mm512_set1_epi64(37)), 8));
+        __mmask8 zero = _mm512_testn_epi64_mask(v, v);
+        __m512i sh = _mm512_mask_blend_epi64(zero, _mm512_add_epi64(t1, one), one);
+        __m512i pre = _mm512_sub_epi64(_mm512_sllv_epi64(one, _mm512_sub_epi64(sh, one)), one);
+        __m512i e = _mm512_or_si512(_mm512_sllv_epi64(v, sh), pre);
+        __m128i m = _mm512_cvtepi64_epi8(_mm512_shuffle_epi8(mask_lut, sh));
+        __mmask64 k = (__mmask64)_mm_cvtsi128_si64(m);
+        _mm512_mask_compressstoreu_epi8(d + o, k, e);
+        o += (size_t)_mm_popcnt_u64(k);
+    }
+
+    vlu_io_result r = vlu_encode(d + o, cap - o, s + i, l - i);
+    return vlu_io_result{ i + r.nread, o + r.nwritten };
+}
+
+/*
+ * vlu_encode_vec_avx512 - encode array using byte compress
+ */
+VLU_TARGET_AVX512
+static void vlu_encode_vec_avx512(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound(n)) {
+            dst.resize(o + vlu_encode_bound(n));
+        }
+        vlu_io_result r = vlu_encode_avx512(dst.data() + o, dst.size() - o, src.data() + i, n);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+VLU_AVX512_END
+#endif
+
+/*
+ * vlu_decode_simd - decode buffer into array with the widest kernel
+ *
+ * Selects the AVX-512, AVX2 or scalar kernel at runtime. Used by the
+ * vector, block, stream and parallel decoders.
+ */
+static vlu_io_result vlu_decode_simd(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if USE_AVX512_VBMI2
+    if (vlu_cpu_avx512vbmi2()) return vlu_decode_avx512(dst, cap, src, len);
+#endif
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_decode_avx2(dst, cap, src, len);
+#endif
+    return vlu_decode(dst, cap, src, len);
+}
+
+/*
+ * vlu_encode_simd - encode array into buffer with the widest kernel
+ *
+ * Selects the AVX-512 or scalar kernel at runtime.
+ */
+static vlu_io_result vlu_encode_simd(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+#if USE_AVX512_VBMI2
+    if (vlu_cpu_avx512vbmi2()) return vlu_encode_avx512(dst, cap, src, n);
+#endif
+    return vlu_encode(dst, cap, src, n);
+}
+
+/*
+ * vlu_encode_map_simd - encode mapped array with the widest kernel
+ *
+ * The AVX-512 kernel takes plain values, so the map is applied to a
+ * block of values at a time in a buffer on the stack.
+ */
+template <typename M>
+static vlu_io_result vlu_encode_map_simd(uint8_t *dst, size_t cap, const typename M::type *src, size_t n, const M &m)
+{
+#if USE_AVX512_VBMI2
+    if (vlu_cpu_avx512vbmi2()) {
+        uint64_t x[256];
+        size_t i = 0, o = 0;
+        while (i < n) {
+            size_t k = std::min((size_t)256, n - i);
+            for (size_t j = 0; j < k; j++) x[j] = m.enc(src, i + j);
+            vlu_io_result r = vlu_encode_avx512(dst + o, cap - o, x, k);
+            i += r.nread;
+            o += r.nwritten;
+            if (r.nread < k) break;
+        }
+        return vlu_io_result{ i, o };
+    }
+#endif
+    return vlu_encode_map(dst, cap, src, n, m);
+}
+
+/*
+ * vlu_decode_map_simd - decode into mapped array with the widest kernel
+ *
+ * The SIMD kernels produce plain values, so a block of values at a time
+ * is decoded into a buffer on the stack and mapped while it is in L1.
+ * Without them the map is applied in the scalar kernel.
+ */
+template <typename M>
+static vlu_io_result vlu_decode_map_simd(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+#if USE_AVX512_VBMI2 || USE_AVX2
+    if (vlu_cpu_avx512vbmi2() || vlu_cpu_avx2()) {
+        uint64_t x[256];
+        size_t i = 0, o = 0;
+        while (o < cap) {
+            size_t k = std::min((size_t)256, cap - o);
+            vlu_io_result r = vlu_decode_simd(x, k, src + i, len - i);
+            for (size_t j = 0; j < r.nwritten; j++) dst[o + j] = m.dec(x[j]);
+            i += r.nread;
+            o += r.nwritten;
+            if (r.nwritten < k) break;
+        }
+        return vlu_io_result{ i, o };
+    }
+#endif
+#if VLU_ASM_BMI2
+    if (vlu_cpu_bmi2()) return vlu_decode_map_bmi2(dst, cap, src, len, m);
+#endif
+    return vlu_decode_map(dst, cap, src, len, m);
+}
+
+/*
+ * vlu_size_vec - calculate packed size in bytes
+ */
+static size_t vlu_size_vec(std::vector<uint64_t> &vec)
+{
+    return vlu_size(vec.data(), vec.size());
+}
+
+/*
+ * vlu_size_vec - get size of array
+ */
+static size_t vlu_items_vec(std::vector<uint8_t> &vec)
+{
+    return vlu_items(vec.data(), vec.size());
+}
+
+/*
+ * vlu_encode_vec - encode array
+ *
+ * Encodes in a single pass. The output grows a chunk at a time for the
+ * worst case of 10 bytes per value, so that every packet can be written
+ * with a full word store, and is trimmed once at the end. Hosts with
+ * AVX-512 VBMI2 use the byte compress kernel.
+ */
+static void vlu_encode_vec(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound(n)) {
+            dst.resize(o + vlu_encode_bound(n));
+        }
+        vlu_io_result r = vlu_encode_simd(dst.data() + o, dst.size() - o, src.data() + i, n);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * vlu_decode_vec - decode array
+ *
+ * Counts and decodes with the widest kernels the CPU supports.
+ */
+static void vlu_decode_vec(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_simd(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * Checked decoding
+ *
+ * For streams from untrusted sources. Truncation and packets whose
+ * value does not fit in 64 bits are reported with the byte offset of
+ * the packet instead of being caught by assertions. A packet is read
+ * with two unchecked 8-byte loads while at least 16 bytes remain, so
+ * the bulk of the stream has no bounds checks; the last 15 bytes are
+ * copied into a zeroed buffer and decoded the same way.
+ */
+
+enum vlu_status
+{
+    vlu_ok,
+    vlu_truncated,
+    vlu_overflow,
+};
+
+struct vlu_checked_result
+{
+    size_t nread;
+    size_t nwritten;
+    vlu_status status;
+};
+
+/*
+ * vlu_decode_checked_64 - decode packet, rejecting values over 64 bits
+ *
+ * After a continuation byte only a 1-byte terminal or a 2-byte terminal
+ * carrying 8 bits can follow, anything else is reported as overflow.
+ */
+static vlu_status vlu_decode_checked_64(uint64_t lo, uint64_t hi, vlu_result &r)
+{
+    r = vlu_decode_64(lo, hi);
+    bool bad = (hi & 3) == 3 || ((hi & 1) && (hi & 0xfc00));
+    return (lo & 0xff) == 0xff && bad ? vlu_overflow : vlu_ok;
+}
+
+/*
+ * vlu_decode_checked - decode untrusted buffer into array
+ *
+ * Decodes packets until the array is full, the buffer is exhausted or
+ * an invalid packet is found. On error nread is the offset of the
+ * offending packet and nwritten the count of values before it.
+ *
+ * returns {
+ *   nread:    number of bytes consumed
+ *   nwritten: number of values decoded
+ *   status:   vlu_ok, vlu_truncated or vlu_overflow
+ * }
+ */
+template <typename M, typename S = vlu_step_scalar>
+static vlu_checked_result vlu_decode_checked_map(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+    size_t i = 0, o = 0;
+    vlu_result r;
+
+    for (; i + 16 <= len && o < cap; o++) {
+        uint64_t lo, hi;
+        std::memcpy(&lo, src + i, 8);
+        std::memcpy(&hi, src + i + 8, 8);
+        r = S::decode_56(lo);
+        if (r.shamt < 0 && vlu_decode_checked_64(lo, hi, r) != vlu_ok) {
+            return vlu_checked_result{ i, o, vlu_overflow };
+        }
+        dst[o] = m.dec(r.val);
+        i += r.shamt;
+    }
+
+    for (; i < len && o < cap; o++) {
+        uint8_t w[16] = { 0 };
+        size_t s = std::min((size_t)16, len - i);
+        std::memcpy(w, src + i, s);
+        uint64_t lo, hi;
+        std::memcpy(&lo, w, 8);
+        std::memcpy(&hi, w + 8, 8);
+        vlu_status st = vlu_decode_checked_64(lo, hi, r);
+        if (st == vlu_ok && (size_t)r.shamt > s) st = vlu_truncated;
+        if (st != vlu_ok) {
+            return vlu_checked_result{ i, o, st };
+        }
+        dst[o] = m.dec(r.val);
+        i += r.shamt;
+    }
+
+    return vlu_checked_result{ i, o, vlu_ok };
+}
+
+#if VLU_ASM_BMI2
+template <typename M>
+VLU_TARGET_BMI2
+static vlu_checked_result vlu_decode_checked_map_bmi2(typename M::type *dst, size_t cap, const uint8_t *src, size_t len, const M &m)
+{
+    return vlu_decode_checked_map<M, vlu_step_bmi2>(dst, cap, src, len, m);
+}
+#endif
+
+static vlu_checked_result vlu_decode_checked(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if VLU_ASM_BMI2
+    if (vlu_cpu_bmi2()) return vlu_decode_checked_map_bmi2(dst, cap, src, len, vlu_map_unsigned());
+#endif
+    return vlu_decode_checked_map(dst, cap, src, len, vlu_map_unsigned());
+}
+
+/*
+ * vlu_decode_vec_checked - decode untrusted array
+ *
+ * Decodes in a single pass with no separate count of the items. The
+ * output grows a chunk at a time, bounded by the bytes remaining, and
+ * holds the values before the error if the status is not vlu_ok.
+ */
+static vlu_checked_result vlu_decode_vec_checked(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    vlu_checked_result r{ 0, 0, vlu_ok };
+
+    while (r.nread < l && r.status == vlu_ok) {
+        size_t n = std::min(chunk, l - r.nread);
+        dst.resize(r.nwritten + n);
+        vlu_checked_result s = vlu_decode_checked(dst.data() + r.nwritten, n,
+            src.data() + r.nread, l - r.nread);
+        r = vlu_checked_result{ r.nread + s.nread, r.nwritten + s.nwritten, s.status };
+    }
+
+    dst.resize(r.nwritten);
+    return r;
+}
+
+/*
+ * svlu_size - calculate packed size in bytes of signed array
+ */
+static size_t svlu_size(const int64_t *src, size_t n)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t shamt = svlu_encoded_size_64(src[i]);
+        assert(shamt > 0 && shamt < 11);
+        len += shamt;
+    }
+    return len;
+}
+
+/*
+ * svlu_encode - encode signed array into buffer
+ *
+ * Same as vlu_encode with the zigzag map applied in the kernel.
+ */
+static vlu_io_result svlu_encode(uint8_t *dst, size_t cap, const int64_t *src, size_t n)
+{
+    return vlu_encode_map_simd(dst, cap, src, n, vlu_map_zigzag());
+}
+
+/*
+ * svlu_decode - decode buffer into signed array
+ *
+ * Same as vlu_decode with the zigzag map applied in the kernel.
+ */
+static vlu_io_result svlu_decode(int64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+    return vlu_decode_map_simd(dst, cap, src, len, vlu_map_zigzag());
+}
+
+/*
+ * svlu_decode_checked - decode untrusted buffer into signed array
+ *
+ * Same as vlu_decode_checked with the zigzag map applied in the kernel.
+ */
+static vlu_checked_result svlu_decode_checked(int64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if VLU_ASM_BMI2
+    if (vlu_cpu_bmi2()) return vlu_decode_checked_map_bmi2(dst, cap, src, len, vlu_map_zigzag());
+#endif
+    return vlu_decode_checked_map(dst, cap, src, len, vlu_map_zigzag());
+}
+
+/*
+ * svlu_size_vec - calculate packed size in bytes of signed array
+ */
+static size_t svlu_size_vec(std::vector<int64_t> &vec)
+{
+    return svlu_size(vec.data(), vec.size());
+}
+
+/*
+ * svlu_encode_vec - encode signed array
+ */
+static void svlu_encode_vec(std::vector<uint8_t> &dst, std::vector<int64_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound(n)) {
+            dst.resize(o + vlu_encode_bound(n));
+        }
+        vlu_io_result r = svlu_encode(dst.data() + o, dst.size() - o, src.data() + i, n);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * svlu_decode_vec - decode signed array
+ */
+static void svlu_decode_vec(std::vector<int64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = svlu_decode(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * vlu_prefix_sum - inclusive prefix sum in place
+ *
+ * Adds base and all preceding values to each value and returns the
+ * last sum, or base if the array is empty. The AVX2 version scans four
+ * values in registers and carries the running sum as a broadcast, so
+ * the serial dependency is a single add for every four values.
+ */
+#if USE_AVX2
+VLU_TARGET_AVX2
+static uint64_t vlu_prefix_sum_avx2(uint64_t *x, size_t n, uint64_t base)
+{
+    const __m256i z = _mm256_setzero_si256();
+    __m256i c = _mm256_set1_epi64x(base);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        v = _mm256_add_epi64(v, _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x90), z, 0x03));
+        v = _mm256_add_epi64(v, _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x40), z, 0x0f));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), _mm256_add_epi64(v, c));
+        c = _mm256_add_epi64(c, _mm256_permute4x64_epi64(v, 0xff));
+    }
+
+    uint64_t sum = _mm_cvtsi128_si64(_mm256_castsi256_si128(c));
+    for (; i < n; i++) {
+        x[i] = sum += x[i];
+    }
+    return sum;
+}
+#endif
+
+static uint64_t vlu_prefix_sum_scalar(uint64_t *x, size_t n, uint64_t base)
+{
+    uint64_t sum = base;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = sum += x[i];
+    }
+    return sum;
+}
+
+static uint64_t vlu_prefix_sum(uint64_t *x, size_t n, uint64_t base)
+{
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_prefix_sum_avx2(x, n, base);
+#endif
+    return vlu_prefix_sum_scalar(x, n, base);
+}
+
+/*
+ * Delta coding
+ *
+ * Sorted arrays are encoded as differences from the preceding value
+ * and time series as zigzag differences from the preceding difference
+ * (delta-of-delta). Decoding runs the kernel over cache sized chunks
+ * and reconstructs each chunk with one or two prefix sums, rather than
+ * carrying the running value through the packet decode loop.
+ */
+
+static const size_t vlu_delta_chunk = 1024;
+
+/*
+ * vlu_encode_delta - encode non-decreasing array as deltas
+ *
+ * prev is the value preceding the array, zero at the start of a
+ * sequence. Decreasing values round trip but take ten bytes.
+ */
+static vlu_io_result vlu_encode_delta(uint8_t *dst, size_t cap, const uint64_t *src, size_t n, uint64_t prev)
+{
+    return vlu_encode_map_simd(dst, cap, src, n, vlu_map_delta{ prev });
+}
+
+/*
+ * vlu_decode_delta - decode deltas into array
+ */
+static vlu_io_result vlu_decode_delta(uint64_t *dst, size_t cap, const uint8_t *src, size_t len, uint64_t prev)
+{
+    size_t i = 0, o = 0;
+
+    while (o < cap) {
+        size_t n = std::min(vlu_delta_chunk, cap - o);
+        vlu_io_result r = vlu_decode_simd(dst + o, n, src + i, len - i);
+        if (r.nwritten == 0) break;
+        prev = vlu_prefix_sum(dst + o, r.nwritten, prev);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    return vlu_io_result{ i, o };
+}
+
+/*
+ * vlu_encode_dod - encode array as delta-of-deltas
+ *
+ * prev is the value preceding the array and delta the difference
+ * between prev and the value before it, both zero at the start of
+ * a sequence.
+ */
+static vlu_io_result vlu_encode_dod(uint8_t *dst, size_t cap, const uint64_t *src, size_t n,
+    uint64_t prev, uint64_t delta)
+{
+    return vlu_encode_map_simd(dst, cap, src, n, vlu_map_dod{ prev, delta });
+}
+
+/*
+ * vlu_decode_dod - decode delta-of-deltas into array
+ */
+static vlu_io_result vlu_decode_dod(uint64_t *dst, size_t cap, const uint8_t *src, size_t len,
+    uint64_t prev, uint64_t delta)
+{
+    size_t i = 0, o = 0;
+
+    while (o < cap) {
+        size_t n = std::min(vlu_delta_chunk, cap - o);
+        vlu_io_result r = svlu_decode(reinterpret_cast<int64_t*>(dst + o), n, src + i, len - i);
+        if (r.nwritten == 0) break;
+        delta = vlu_prefix_sum(dst + o, r.nwritten, delta);
+        prev = vlu_prefix_sum(dst + o, r.nwritten, prev);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    return vlu_io_result{ i, o };
+}
+
+/*
+ * vlu_encode_vec_delta - encode non-decreasing array as deltas
+ */
+static void vlu_encode_vec_delta(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound(n)) {
+            dst.resize(o + vlu_encode_bound(n));
+        }
+        uint64_t prev = i > 0 ? src[i-1] : 0;
+        vlu_io_result r = vlu_encode_delta(dst.data() + o, dst.size() - o, src.data() + i, n, prev);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * vlu_decode_vec_delta - decode deltas into array
+ */
+static void vlu_decode_vec_delta(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_delta(dst.data(), items, src.data(), src.size(), 0);
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * vlu_encode_vec_dod - encode array as delta-of-deltas
+ */
+static void vlu_encode_vec_dod(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound(n)) {
+            dst.resize(o + vlu_encode_bound(n));
+        }
+        uint64_t prev = i > 0 ? src[i-1] : 0;
+        uint64_t delta = i > 1 ? src[i-1] - src[i-2] : prev;
+        vlu_io_result r = vlu_encode_dod(dst.data() + o, dst.size() - o, src.data() + i, n, prev, delta);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * vlu_decode_vec_dod - decode delta-of-deltas into array
+ */
+static void vlu_decode_vec_dod(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_dod(dst.data(), items, src.data(), src.size(), 0, 0);
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * vlu_encode_bound_112 - worst case packed size in bytes
+ */
+static size_t vlu_encode_bound_112(size_t n)
+{
+    return n * 19;
+}
+
+/*
+ * vlu_size_112 - calculate packed size in bytes
+ */
+static size_t vlu_size_112(const vlu_u128 *src, size_t n)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t shamt = vlu_encoded_size_128(src[i].lo, src[i].hi);
+        assert(shamt > 0 && shamt < 20);
+        len += shamt;
+    }
+    return len;
+}
+
+/*
+ * vlu_items_112 - get number of values in buffer
+ *
+ * Continuation intervals are stepped over without being counted.
+ */
+static size_t vlu_items_112(const uint8_t *src, size_t len)
+{
+    size_t items = 0;
+    for (size_t i = 0; i < len; ) {
+        uint64_t d = src[i];
+        if (d == 0xff && i + 1 < len) d |= (uint64_t)src[i + 1] << 8;
+        i += vlu_decoded_size_112(d);
+        items += d != 0xffff;
+    }
+    return items;
+}
+
+/*
+ * vlu_encode_buf_112 - encode array into buffer
+ *
+ * returns {
+ *   nread:    number of values encoded
+ *   nwritten: number of bytes written
+ * }
+ */
+static vlu_io_result vlu_encode_buf_112(uint8_t *dst, size_t cap, const vlu_u128 *src, size_t n)
+{
+    size_t i = 0, o = 0;
+
+    for (; i < n && o + 24 <= cap; i++) {
+        o += vlu_encode_128(dst + o, src[i].lo, src[i].hi);
+    }
+
+    for (; i < n; i++) {
+        uint8_t w[24];
+        size_t s = vlu_encode_128(w, src[i].lo, src[i].hi);
+        if (o + s > cap) break;
+        std::memcpy(dst + o, w, s);
+        o += s;
+    }
+
+    return vlu_io_result{ i, o };
+}
+
+/*
+ * vlu_decode_buf_112 - decode buffer into array
+ *
+ * The BMI2 step is selected at runtime.
+ *
+ * returns {
+ *   nread:    number of bytes consumed
+ *   nwritten: number of values decoded
+ * }
+ */
+template <typename S>
+static vlu_io_result vlu_decode_kernel_112(vlu_u128 *dst, size_t cap, const uint8_t *src, size_t len)
+{
+    size_t i = 0, o = 0;
+
+    for (; i + 24 <= len && o < cap; o++) {
+        vlu_result_112 r = vlu_decode_128<S>(src + i);
+        dst[o] = vlu_u128{ r.lo, r.hi };
+        i += r.shamt;
+    }
+
+    for (; i < len && o < cap; o++) {
+        uint8_t w[24] = { 0 };
+        size_t s = std::min((size_t)24, len - i);
+        std::memcpy(w, src + i, s);
+        vlu_result_112 r = vlu_decode_128<S>(w);
+        if ((size_t)r.shamt > s) break;
+        dst[o] = vlu_u128{ r.lo, r.hi };
+        i += r.shamt;
+    }
+
+    return vlu_io_result{ i, o };
+}
+
+#if USE_BMI2
+VLU_TARGET_BMI2 VLU_FLATTEN
+static vlu_io_result vlu_decode_buf_112_bmi2(vlu_u128 *dst, size_t cap, const uint8_t *src, size_t len)
+{
+    return vlu_decode_kernel_112<vlu_step_112_bmi2>(dst, cap, src, len);
+}
+#endif
+
+static vlu_io_result vlu_decode_buf_112(vlu_u128 *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if USE_BMI2
+    if (vlu_cpu_bmi2()) return vlu_decode_buf_112_bmi2(dst, cap, src, len);
+#endif
+    return vlu_decode_kernel_112<vlu_step_112_scalar>(dst, cap, src, len);
+}
+
+/*
+ * vlu_encode_vec_112 - encode array
+ */
+static void vlu_encode_vec_112(std::vector<uint8_t> &dst, std::vector<vlu_u128> &src)
+{
+    const size_t chunk = 1024;
+    size_t l = src.size();
+    size_t o = 0;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(chunk, l - i);
+        if (dst.size() < o + vlu_encode_bound_112(n)) {
+            dst.resize(o + vlu_encode_bound_112(n));
+        }
+        vlu_io_result r = vlu_encode_buf_112(dst.data() + o, dst.size() - o, src.data() + i, n);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * vlu_decode_vec_112 - decode array
+ */
+static void vlu_decode_vec_112(std::vector<vlu_u128> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = vlu_items_112(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = vlu_decode_buf_112(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
+}
+
+/*
+ * Arbitrary precision integers using continuation intervals
+ *
+ * Little-endian limb arrays are encoded 56 bits at a time as 64-bit
+ * continuation intervals, 0xff followed by 7 bytes of the value, until
+ * the remainder fits in a terminal VLU8 packet of 1 to 8 bytes. As 56
+ * bits is a whole number of bytes, interval k holds bytes 7k to 7k+6
+ * of the limb array, so each interval is a single word copy.
+ */
+
+/*
+ * vlu_big_bytes - number of significant bytes in a limb array
+ */
+static size_t vlu_big_bytes(const uint64_t *limbs, size_t n)
+{
+    while (n > 0 && limbs[n - 1] == 0) n--;
+    if (n == 0) return 0;
+    return (n - 1) * 8 + 8 - (clz(limbs[n - 1]) >> 3);
+}
+
+/*
+ * vlu_encoded_size_big - encoded size of a limb array in bytes
+ */
+static size_t vlu_encoded_size_big(const uint64_t *limbs, size_t n)
+{
+    size_t nbytes = vlu_big_bytes(limbs, n);
+    size_t k = nbytes > 7 ? (nbytes - 1) / 7 : 0;
+    uint64_t rest = 0;
+    std::memcpy(&rest, reinterpret_cast<const uint8_t*>(limbs) + k * 7, nbytes - k * 7);
+    return k * 8 + vlu_encoded_size_56(rest);
+}
+
+/*
+ * vlu_encode_big - encode limb array into buffer
+ *
+ * returns {
+ *   nread:    number of limbs, or zero if the buffer is too small
+ *   nwritten: number of bytes written
+ * }
+ */
+static vlu_io_result vlu_encode_big(uint8_t *dst, size_t cap, const uint64_t *limbs, size_t n)
+{
+    const uint8_t *s = reinterpret_cast<const uint8_t*>(limbs);
+    size_t nbytes = vlu_big_bytes(limbs, n);
+    size_t k = nbytes > 7 ? (nbytes - 1) / 7 : 0;
+    size_t o = 0;
+
+    uint64_t rest = 0;
+    std::memcpy(&rest, s + k * 7, nbytes - k * 7);
+    vlu_result r = vlu_encode_56(rest);
+    assert(r.shamt > 0 && r.shamt < 9);
+    if (k * 8 + r.shamt > cap) return vlu_io_result{ 0, 0 };
+
+    for (size_t j = 0; j < k; j++, o += 8) {
+        uint64_t w = 0;
+        std::memcpy(&w, s + j * 7, j * 7 + 8 <= n * 8 ? 8 : 7);
+        w = (w << 8) | 0xff;
+        std::memcpy(dst + o, &w, 8);
+    }
+
+    std::memcpy(dst + o, &r.val, r.shamt);
+    o += r.shamt;
+
+    return vlu_io_result{ n, o };
+}
+
+/*
+ * vlu_decode_big - decode buffer into limb array
+ *
+ * Limbs above the decoded value are cleared.
+ *
+ * returns {
+ *   nread:    number of bytes consumed, or zero if the value is
+ *             truncated or does not fit in the limb array
+ *   nwritten: number of significant limbs
+ * }
+ */
+static vlu_io_result vlu_decode_big(uint64_t *limbs, size_t cap, const uint8_t *src, size_t len)
+{
+    uint8_t *d = reinterpret_cast<uint8_t*>(limbs);
+    size_t dbytes = cap * 8;
+    size_t i = 0, k = 0;
+
+    std::memset(limbs, 0, dbytes);
+
+    for (; i + 8 <= len && src[i] == 0xff; i += 8, k += 7) {
+        if (k + 7 > dbytes) return vlu_io_result{ 0, 0 };
+        uint64_t w;
+        std::memcpy(&w, src + i, 8);
+        w >>= 8;
+        std::memcpy(d + k, &w, k + 8 <= dbytes ? 8 : 7);
+    }
+
+    if (i == len || src[i] == 0xff) return vlu_io_result{ 0, 0 };
+
+    uint64_t w = 0;
+    size_t s = std::min((size_t)8, len - i);
+    std::memcpy(&w, src + i, s);
+    vlu_result r = vlu_decode_56(w);
+    assert(r.shamt > 0);
+    if ((size_t)r.shamt > s) return vlu_io_result{ 0, 0 };
+    size_t vbytes = r.val ? 8 - (clz(r.val) >> 3) : 0;
+    if (k + vbytes > dbytes) return vlu_io_result{ 0, 0 };
+    std::memcpy(d + k, &r.val, vbytes);
+
+    size_t n = (k + vbytes + 7) >> 3;
+    while (n > 0 && limbs[n - 1] == 0) n--;
+
+    return vlu_io_result{ i + r.shamt, n };
+}
+
+/*
+ * vlu_encode_vec_big - encode limb array
+ */
+static void vlu_encode_vec_big(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    dst.resize(vlu_encoded_size_big(src.data(), src.size()));
+
+    vlu_io_result r = vlu_encode_big(dst.data(), dst.size(), src.data(), src.size());
+    assert(r.nwritten == dst.size());
+    (void)r;
+}
+
+/*
+ * vlu_decode_vec_big - decode limb array
+ *
+ * The array is sized from the input so any value fits. Truncated input
+ * leaves the array empty and returns vlu_truncated.
+ */
+static vlu_status vlu_decode_vec_big(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    /* every 8 encoded bytes hold at most 7 bytes of the value */
+    dst.resize((src.size() * 7 / 8 + 7) / 8 + 1);
+
+    vlu_io_result r = vlu_decode_big(dst.data(), dst.size(), src.data(), src.size());
+    dst.resize(r.nwritten);
+    return r.nread > 0 ? vlu_ok : vlu_truncated;
+}
+
+
+/*
+ * vlu_skip - advance past n values without decoding them
+ *
+ * Returns the position after n values, or after the last complete
+ * value if the buffer holds fewer than n.
+ */
+static const uint8_t* vlu_skip(const uint8_t *ptr, const uint8_t *end, size_t n)
+{
+    size_t l = end - ptr;
+#if USE_AVX512_VBMI2
+    if (vlu_cpu_avx512vbmi2()) return ptr + vlu_skip_avx512(ptr, l, n);
+#endif
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return ptr + vlu_skip_avx2(ptr, l, n);
+#endif
+    return ptr + vlu_skip_scalar(ptr, l, 0, n);
+}
+
+/*
+ * vlu_stream_decoder - resumable decoder for chunked input
+ *
+ * Packets may straddle chunk boundaries. The leading bytes of a packet
+ * cut short by the end of a chunk are held (at most 9) and completed
+ * from the start of the next chunk, so a stream can be decoded in
+ * bounded memory from socket reads or file blocks.
+ */
+struct vlu_stream_decoder
+{
+    uint8_t part[16];
+    size_t npart;
+
+    vlu_stream_decoder() : npart(0) {}
+
+    /*
+     * held_size - size of the held packet, as far as it is known
+     */
+    size_t held_size() const
+    {
+        if (part[0] != 0xff) return vlu_decoded_size_56(part[0]);
+        return npart > 8 ? 8 + vlu_decoded_size_56(part[8]) : 9;
+    }
+
+    /*
+     * reset - discard any partial packet
+     */
+    void reset()
+    {
+        npart = 0;
+    }
+
+    /*
+     * pending - number of bytes held from an incomplete packet
+     */
+    size_t pending() const
+    {
+        return npart;
+    }
+
+    /*
+     * decode - decode the next chunk of the stream
+     *
+     * Bytes not consumed because the array is full must be passed
+     * again at the start of the next call. A non-zero pending count
+     * after the last chunk indicates a truncated stream.
+     *
+     * returns {
+     *   nread:    number of bytes consumed
+     *   nwritten: number of values decoded
+     * }
+     */
+    vlu_io_result decode(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+    {
+        size_t i = 0, o = 0;
+
+        if (cap == 0) return vlu_io_result{ 0, 0 };
+
+        if (npart > 0) {
+            while (npart < held_size() && i < len) {
+                part[npart++] = src[i++];
+            }
+            if (npart < held_size()) return vlu_io_result{ i, 0 };
+            vlu_io_result r = vlu_decode(dst, 1, part, npart);
+            assert(r.nread == npart && r.nwritten == 1);
+            o += r.nwritten;
+            npart = 0;
+        }
+
+        vlu_io_result r = vlu_decode_simd(dst + o, cap - o, src + i, len - i);
+        i += r.nread;
+        o += r.nwritten;
+
+        /* space remains, so decoding stopped on a truncated packet */
+        if (o < cap && i < len) {
+            assert(len - i < 10);
+            npart = len - i;
+            std::memcpy(part, src + i, npart);
+            i = len;
+        }
+
+        return vlu_io_result{ i, o };
+    }
+};
+
+/*
+ * vlu_stream_encoder - encoder with fixed-size output blocks
+ *
+ * Values are packed into a block allocated once at construction, and
+ * the sink is called each time the block fills. Packets are split
+ * across block boundaries so every block passed to the sink is full
+ * except the last one, which is emitted by flush.
+ */
+struct vlu_stream_encoder
+{
+    typedef std::function<void(const uint8_t *data, size_t len)> sink_fn;
+
+    std::vector<uint8_t> block;
+    size_t used;
+    sink_fn sink;
+
+    vlu_stream_encoder(sink_fn sink, size_t block_size = 65536)
+        : block(std::max(block_size, (size_t)1)), used(0), sink(sink) {}
+
+    /*
+     * put - encode one value
+     */
+    void put(uint64_t num)
+    {
+        vlu_result_112 r = vlu_encode_64(num);
+        assert(r.shamt > 0 && r.shamt < 11);
+        size_t cap = block.size();
+        if (used + 16 <= cap) {
+            std::memcpy(&block[used], &r.lo, 8);
+            std::memcpy(&block[used + 8], &r.hi, 8);
+            used += r.shamt;
+            if (used == cap) emit();
+            return;
+        }
+        uint8_t w[16];
+        std::memcpy(w, &r.lo, 8);
+        std::memcpy(w + 8, &r.hi, 8);
+        const uint8_t *p = w;
+        for (size_t n = r.shamt; n > 0; ) {
+            size_t m = std::min(n, cap - used);
+            std::memcpy(&block[used], p, m);
+            used += m;
+            p += m;
+            n -= m;
+            if (used == cap) emit();
+        }
+    }
+
+    /*
+     * put - encode an array of values
+     */
+    void put(const uint64_t *src, size_t n)
+    {
+        for (size_t i = 0; i < n; ) {
+            vlu_io_result r = vlu_encode(&block[used], block.size() - used, src + i, n - i);
+            i += r.nread;
+            used += r.nwritten;
+            /* the next packet straddles the end of the block */
+            if (i < n) put(src[i++]);
+        }
+    }
+
+    /*
+     * flush - pass the partially filled block to the sink
+     */
+    void flush()
+    {
+        if (used > 0) emit();
+    }
+
+    void emit()
+    {
+        sink(block.data(), used);
+        used = 0;
+    }
+};
+
+/*
+ * Frame of reference
+ *
+ * Values clustered around a large base are coded in blocks, each with
+ * the block minimum as a base packet followed by the residuals:
+ *
+ *   | block size | base | residual ... | base | residual ... | ...
+ *
+ * Every block except the last holds block size values.
+ */
+
+/*
+ * vlu_add_base - add base to each value in place
+ */
+#if USE_AVX2
+VLU_TARGET_AVX2
+static void vlu_add_base_avx2(uint64_t *x, size_t n, uint64_t base)
+{
+    const __m256i b = _mm256_set1_epi64x(base);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), _mm256_add_epi64(v0, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i + 4), _mm256_add_epi64(v1, b));
+    }
+    for (; i < n; i++) {
+        x[i] += base;
+    }
+}
+#endif
+
+static void vlu_add_base_scalar(uint64_t *x, size_t n, uint64_t base)
+{
+    for (size_t i = 0; i < n; i++) {
+        x[i] += base;
+    }
+}
+
+static void vlu_add_base(uint64_t *x, size_t n, uint64_t base)
+{
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_add_base_avx2(x, n, base);
+#endif
+    vlu_add_base_scalar(x, n, base);
+}
+
+/*
+ * vlu_encoded_size_for - packed size in bytes of one block
+ */
+static size_t vlu_encoded_size_for(const uint64_t *src, size_t n)
+{
+    if (n == 0) return 0;
+    uint64_t base = *std::min_element(src, src + n);
+    size_t len = vlu_encoded_size_64(base);
+    for (size_t i = 0; i < n; i++) {
+        len += vlu_encoded_size_64(src[i] - base);
+    }
+    return len;
+}
+
+/*
+ * vlu_size_for - packed size in bytes including the block size header
+ */
+static size_t vlu_size_for(const uint64_t *src, size_t n, size_t block)
+{
+    size_t len = vlu_encoded_size_64(block);
+    for (size_t i = 0; i < n; i += block) {
+        len += vlu_encoded_size_for(src + i, std::min(block, n - i));
+    }
+    return len;
+}
+
+/*
+ * vlu_encode_for - encode one block as base and residuals
+ *
+ * returns {
+ *   nread:    number of values, or zero if the buffer is too small
+ *   nwritten: number of bytes written
+ * }
+ */
+static vlu_io_result vlu_encode_for(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+    if (n == 0) return vlu_io_result{ 0, 0 };
+    uint64_t base = *std::min_element(src, src + n);
+
+    vlu_io_result b = vlu_encode(dst, cap, &base, 1);
+    if (b.nread != 1) return vlu_io_result{ 0, 0 };
+    vlu_io_result r = vlu_encode_map(dst + b.nwritten, cap - b.nwritten,
+        src, n, vlu_map_base{ base });
+    if (r.nread != n) return vlu_io_result{ 0, 0 };
+
+    return vlu_io_result{ n, b.nwritten + r.nwritten };
+}
+
+/*
+ * vlu_decode_for - decode one block of n values
+ *
+ * returns {
+ *   nread:    number of bytes consumed, or zero if the block is truncated
+ *   nwritten: number of values decoded
+ * }
+ */
+static vlu_io_result vlu_decode_for(uint64_t *dst, size_t n, const uint8_t *src, size_t len)
+{
+    if (n == 0) return vlu_io_result{ 0, 0 };
+    uint64_t base;
+
+    vlu_io_result b = vlu_decode(&base, 1, src, len);
+    if (b.nwritten != 1) return vlu_io_result{ 0, 0 };
+    vlu_io_result r = vlu_decode_simd(dst, n, src + b.nread, len - b.nread);
+    if (r.nwritten != n) return vlu_io_result{ 0, 0 };
+    vlu_add_base(dst, n, base);
+
+    return vlu_io_result{ b.nread + r.nread, n };
+}
+
+/*
+ * vlu_encode_vec_for - encode array in frame of reference blocks
+ */
+static void vlu_encode_vec_for(std::vector<uint8_t> &dst, std::vector<uint64_t> &src,
+    size_t block = 128)
+{
+    assert(block > 0);
+    size_t l = src.size();
+
+    uint64_t hdr = block;
+    if (dst.size() < vlu_encode_bound(1)) {
+        dst.resize(vlu_encode_bound(1));
+    }
+    vlu_io_result h = vlu_encode(dst.data(), dst.size(), &hdr, 1);
+    size_t o = h.nwritten;
+
+    for (size_t i = 0; i < l; ) {
+        size_t n = std::min(block, l - i);
+        /* each block has a base packet in addition to its values */
+        if (dst.size() < o + vlu_encode_bound(n + 1)) {
+            dst.resize(o + vlu_encode_bound(n + 1));
+        }
+        vlu_io_result r = vlu_encode_for(dst.data() + o, dst.size() - o, src.data() + i, n);
+        assert(r.nread == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+
+    dst.resize(o);
+}
+
+/*
+ * vlu_decode_vec_for - decode array in frame of reference blocks
+ */
+static void vlu_decode_vec_for(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    uint64_t block = 0;
+    vlu_io_result h = vlu_decode(&block, 1, src.data(), src.size());
+    if (h.nwritten != 1 || block == 0) {
+        dst.clear();
+        return;
+    }
+
+    /* m packets hold n values and ceil(n / block) bases */
+    size_t m = vlu_items(src.data() + h.nread, src.size() - h.nread);
+    size_t l = m - (m + block) / (block + 1);
+    dst.resize(l);
+
+    size_t i = h.nread;
+    for (size_t o = 0; o < l; ) {
+        size_t n = std::min((size_t)block, l - o);
+        vlu_io_result r = vlu_decode_for(dst.data() + o, n, src.data() + i, src.size() - i);
+        assert(r.nwritten == n);
+        i += r.nread;
+        o += r.nwritten;
+    }
+}
+
+
+/*
+ * Group layout
+ *
+ * The unary prefix means a packet must be classified before the next
+ * one can be found. The group layout moves the lengths for every group
+ * of 8 values into a separate control stream, 3 bytes per group with
+ * a 3-bit field holding L-1 for value j at bit 3j, followed by the L
+ * low bytes of each value in little-endian order without a prefix:
+ *
+ *   | control bytes ... | value | value | value | ...
+ *
+ * The control stream is the only source of lengths, so a decoder does
+ * not wait on the data to find the next value, and any 64-bit value
+ * fits in 1 to 8 bytes. A value never takes more bytes than its VLU8
+ * packet, so the layout is at most the control bytes larger than the
+ * interleaved layout, and smaller when values need more than 7 bits.
+ */
+
+/*
+ * vlu_group_bytes - number of bytes of a value in the group layout
+ */
+static int vlu_group_bytes(uint64_t num)
+{
+    return num == 0 ? 1 : 8 - (clz(num) >> 3);
+}
+
+/*
+ * vlu_group_bound - worst case group layout size in bytes
+ */
+static size_t vlu_group_bound(size_t n)
+{
+    return (n + 7) / 8 * 3 + n * 8;
+}
+
+/*
+ * vlu_size_group - calculate group layout size in bytes
+ */
+static size_t vlu_size_group(const uint64_t *src, size_t n)
+{
+    size_t len = (n + 7) / 8 * 3;
+    for (size_t i = 0; i < n; i++) {
+        len += vlu_group_bytes(src[i]);
+    }
+    return len;
+}
+
+/*
+ * vlu_control_group - control bytes for a group of up to 8 values
+ */
+static uint32_t vlu_control_group(const uint64_t *src, size_t n)
+{
+    uint32_t c = 0;
+    for (size_t j = 0; j < n; j++) {
+        c |= (uint32_t)(vlu_group_bytes(src[j]) - 1) << (j * 3);
+    }
+    return c;
+}
+
+/*
+ * vlu_encode_group_range - encode values i to n starting at byte o
+ *
+ * i is the first value of a group. returns the end of the data, or
+ * zero if the buffer is too small.
+ */
+static size_t vlu_encode_group_range(uint8_t *dst, size_t cap, size_t o,
+    const uint64_t *src, size_t i, size_t n)
+{
+    uint32_t c = 0;
+    for (; i < n; i++) {
+        if (i % 8 == 0) {
+            c = vlu_control_group(src + i, std::min((size_t)8, n - i));
+            std::memcpy(dst + i / 8 * 3, &c, 3);
+        }
+        size_t l = ((c >> (i % 8 * 3)) & 7) + 1;
+        if (o + l > cap) return 0;
+        std::memcpy(dst + o, src + i, o + 8 <= cap ? 8 : l);
+        o += l;
+    }
+    return o;
+}
+
+/*
+ * vlu_decode_group_range - decode values o to n starting at byte i
+ *
+ * o is the first value of a group. returns the end of the data, or
+ * zero if the buffer is truncated.
+ */
+static size_t vlu_decode_group_range(uint64_t *dst, size_t n, const uint8_t *src,
+    size_t len, size_t i, size_t o)
+{
+    uint32_t c = 0;
+    for (; o < n; o++) {
+        if (o % 8 == 0) std::memcpy(&c, src + o / 8 * 3, 3);
+        size_t l = ((c >> (o % 8 * 3)) & 7) + 1;
+        if (i + l > len) return 0;
+        uint64_t val = 0;
+        std::memcpy(&val, src + i, i + 8 <= len ? 8 : l);
+        dst[o] = val & (~0ull >> (64 - l * 8));
+        i += l;
+    }
+    return i;
+}
+
+#if USE_AVX2
+/*
+ * vlu_group_table - shuffle vectors that join pairs of values
+ *
+ * Indexed the same as vlu_pair_table, the shuffle is the inverse that
+ * moves the low bytes of two values in separate 64-bit lanes next to
+ * each other.
+ */
+struct vlu_group_table
+{
+    alignas(16) uint8_t shuf[64][16];
+
+    vlu_group_table()
+    {
+        for (size_t l1 = 1; l1 <= 8; l1++) {
+            for (size_t l2 = 1; l2 <= 8; l2++) {
+                size_t k = ((l1 - 1) << 3) | (l2 - 1);
+                for (size_t j = 0; j < 16; j++) {
+                    shuf[k][j] = j < l1 ? (uint8_t)j :
+                        j < l1 + l2 ? (uint8_t)(j - l1 + 8) : 0x80;
+                }
             }
         }
-        size_t y = (i&7)<<3;
-        uint64_t data = y == 0 ? lo : (lo >> y) | (hi << -y);
+    }
+};
 
-        vlu_result r = vlu_decode_56(data);
-        assert(r.shamt > 0);
-        assert(o < items);
-        dst[o] = r.val;
+static const vlu_group_table& vlu_get_group_table()
+{
+    static const vlu_group_table table;
+    return table;
+}
+#endif
 
-        j = i;
-        i += r.shamt;
-        o++;
+/*
+ * vlu_encode_group - encode array into buffer using the group layout
+ *
+ * The AVX2 version joins two values at a time with a table shuffle
+ * into a single 16-byte store.
+ *
+ * returns {
+ *   nread:    number of values, or zero if the buffer is too small
+ *   nwritten: number of bytes written
+ * }
+ */
+#if USE_AVX2
+VLU_TARGET_AVX2
+static vlu_io_result vlu_encode_group_avx2(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+    const vlu_group_table &g = vlu_get_group_table();
+
+    size_t o = (n + 7) / 8 * 3, i = 0;
+    if (o > cap) return vlu_io_result{ 0, 0 };
+
+    for (; i + 8 <= n && o + 64 <= cap; i += 8) {
+        uint32_t c = vlu_control_group(src + i, 8);
+        std::memcpy(dst + i / 8 * 3, &c, 3);
+        for (size_t p = 0; p < 4; p++) {
+            size_t f = (c >> (p * 6)) & 63;
+            size_t k = ((f & 7) << 3) | (f >> 3);
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + p * 2));
+            x = _mm_shuffle_epi8(x, _mm_load_si128(reinterpret_cast<const __m128i*>(g.shuf[k])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o), x);
+            o += (f & 7) + (f >> 3) + 2;
+        }
+    }
+
+    o = vlu_encode_group_range(dst, cap, o, src, i, n);
+    if (o == 0) return vlu_io_result{ 0, 0 };
+
+    return vlu_io_result{ n, o };
+}
+#endif
+
+static vlu_io_result vlu_encode_group_scalar(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+    size_t o = (n + 7) / 8 * 3;
+    if (o > cap) return vlu_io_result{ 0, 0 };
+
+    o = vlu_encode_group_range(dst, cap, o, src, 0, n);
+    if (o == 0) return vlu_io_result{ 0, 0 };
+
+    return vlu_io_result{ n, o };
+}
+
+static vlu_io_result vlu_encode_group(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
+{
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_encode_group_avx2(dst, cap, src, n);
+#endif
+    return vlu_encode_group_scalar(dst, cap, src, n);
+}
+
+/*
+ * vlu_decode_group - decode n values from buffer using the group layout
+ *
+ * The AVX2 version unpacks each pair with one pshufb using the sizes
+ * from the control stream, so the position of the next pair is known
+ * without looking at the data.
+ *
+ * returns {
+ *   nread:    number of bytes consumed, or zero if the buffer is truncated
+ *   nwritten: number of values decoded
+ * }
+ */
+#if USE_AVX2
+VLU_TARGET_AVX2
+static vlu_io_result vlu_decode_group_avx2(uint64_t *dst, size_t n, const uint8_t *src, size_t len)
+{
+    const vlu_pair_table &t = vlu_get_pair_table();
+
+    size_t i = (n + 7) / 8 * 3, o = 0;
+    if (i > len) return vlu_io_result{ 0, 0 };
+
+    for (; o + 8 <= n && i + 64 <= len; o += 8) {
+        uint32_t c = 0;
+        std::memcpy(&c, src + o / 8 * 3, 3);
+        for (size_t p = 0; p < 4; p++) {
+            size_t f = (c >> (p * 6)) & 63;
+            size_t k = ((f & 7) << 3) | (f >> 3);
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            x = _mm_shuffle_epi8(x, _mm_load_si128(reinterpret_cast<const __m128i*>(t.shuf[k])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + o + p * 2), x);
+            i += (f & 7) + (f >> 3) + 2;
+        }
+    }
+
+    i = vlu_decode_group_range(dst, n, src, len, i, o);
+    if (i == 0) return vlu_io_result{ 0, 0 };
+
+    return vlu_io_result{ i, n };
+}
+#endif
+
+static vlu_io_result vlu_decode_group_scalar(uint64_t *dst, size_t n, const uint8_t *src, size_t len)
+{
+    size_t i = (n + 7) / 8 * 3;
+    if (i > len) return vlu_io_result{ 0, 0 };
+
+    i = vlu_decode_group_range(dst, n, src, len, i, 0);
+    if (i == 0) return vlu_io_result{ 0, 0 };
+
+    return vlu_io_result{ i, n };
+}
+
+static vlu_io_result vlu_decode_group(uint64_t *dst, size_t n, const uint8_t *src, size_t len)
+{
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_decode_group_avx2(dst, n, src, len);
+#endif
+    return vlu_decode_group_scalar(dst, n, src, len);
+}
+
+/*
+ * vlu_encode_vec_group - encode array with a count and the group layout
+ *
+ * All 64-bit values are supported.
+ */
+static void vlu_encode_vec_group(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    uint64_t hdr = src.size();
+    dst.resize(vlu_encode_bound(1) + vlu_group_bound(src.size()));
+    vlu_io_result h = vlu_encode(dst.data(), dst.size(), &hdr, 1);
+    vlu_io_result r = vlu_encode_group(dst.data() + h.nwritten, dst.size() - h.nwritten,
+        src.data(), src.size());
+    assert(r.nread == src.size());
+    dst.resize(h.nwritten + r.nwritten);
+}
+
+/*
+ * vlu_decode_vec_group - decode array with a count and the group layout
+ */
+static void vlu_decode_vec_group(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    uint64_t hdr = 0;
+    vlu_io_result h = vlu_decode(&hdr, 1, src.data(), src.size());
+    dst.resize(h.nwritten == 1 && hdr <= src.size() ? hdr : 0);
+    vlu_io_result r = vlu_decode_group(dst.data(), dst.size(), src.data() + h.nread,
+        src.size() - h.nread);
+    assert(r.nwritten == dst.size());
+    (void)r;
+}
+
+/*
+ * vlu_array - packed array with random access
+ *
+ * Holds VLU8 packed values with the byte offset of every sample'th
+ * value, so an element is found by skipping at most sample - 1 packets
+ * from the nearest indexed offset. The packed bytes are followed by
+ * 16 bytes of padding so packets can be read with whole word loads.
+ */
+struct vlu_array
+{
+    static const size_t padding = 16;
+
+    std::vector<uint8_t> data;
+    std::vector<size_t> index;
+    size_t count;
+    size_t sample;
+
+    explicit vlu_array(size_t sample = 64) : data(padding), count(0), sample(sample)
+    {
+        assert(sample > 0);
+    }
+
+    explicit vlu_array(const std::vector<uint64_t> &vec, size_t sample = 64) : vlu_array(sample)
+    {
+        assign(vec.data(), vec.size());
+    }
+
+    /*
+     * assign - encode values and build the index
+     */
+    void assign(const uint64_t *src, size_t n)
+    {
+        size_t len = vlu_size(src, n);
+        data.assign(len + padding, 0);
+        index.resize((n + sample - 1) / sample);
+        count = n;
+
+        size_t o = 0;
+        for (size_t i = 0; i < n; i += sample) {
+            index[i / sample] = o;
+            size_t m = std::min(sample, n - i);
+            vlu_io_result r = vlu_encode(data.data() + o, data.size() - o, src + i, m);
+            assert(r.nread == m);
+            o += r.nwritten;
+        }
+        assert(o == len);
+    }
+
+    /*
+     * assign_packed - copy packed values and build the index
+     *
+     * A packet cut short by the end of the buffer is dropped.
+     */
+    void assign_packed(const uint8_t *src, size_t len)
+    {
+        data.assign(len + padding, 0);
+        if (len) std::memcpy(data.data(), src, len);
+        index.clear();
+        count = 0;
+
+        size_t o = 0;
+        while (o < len) {
+            size_t s = packet_size(o);
+            if (o + s > len) break;
+            if (count % sample == 0) index.push_back(o);
+            o += s;
+            count++;
+        }
+        data.resize(o);
+        data.resize(o + padding, 0);
+    }
+
+    /*
+     * size - number of values
+     */
+    size_t size() const
+    {
+        return count;
     }
+
+    /*
+     * bytes - size of the packed values in bytes
+     */
+    size_t bytes() const
+    {
+        return data.size() - padding;
+    }
+
+    /*
+     * packet_size - size of the packet at a byte offset
+     */
+    size_t packet_size(size_t o) const
+    {
+        const uint8_t *p = data.data() + o;
+        return p[0] != 0xff ? vlu_decoded_size_56(p[0]) : 8 + vlu_decoded_size_56(p[8]);
+    }
+
+    /*
+     * packet_value - value of the packet at a byte offset
+     */
+    uint64_t packet_value(size_t o) const
+    {
+        uint64_t lo, hi;
+        std::memcpy(&lo, data.data() + o, 8);
+        std::memcpy(&hi, data.data() + o + 8, 8);
+        return vlu_decode_64(lo, hi).val;
+    }
+
+    /*
+     * offset - byte offset of a value
+     */
+    size_t offset(size_t i) const
+    {
+        size_t o = index[i / sample];
+        for (size_t j = i % sample; j > 0; j--) {
+            o += packet_size(o);
+        }
+        return o;
+    }
+
+    uint64_t operator[](size_t i) const
+    {
+        assert(i < count);
+        return packet_value(offset(i));
+    }
+
+    /*
+     * decode - decode n values starting at position i
+     */
+    size_t decode(uint64_t *dst, size_t i, size_t n) const
+    {
+        if (i >= count) return 0;
+        size_t o = offset(i);
+        return vlu_decode(dst, std::min(n, count - i), data.data() + o, bytes() - o).nwritten;
+    }
+
+    /*
+     * iterator - walks the packets in order, dereferencing to a decoded
+     * copy of the value, so it is an input iterator rather than forward.
+     */
+    struct iterator
+    {
+        typedef std::input_iterator_tag iterator_category;
+        typedef uint64_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const uint64_t* pointer;
+        typedef uint64_t reference;
+
+        const vlu_array *a;
+        size_t o;
+        size_t i;
+
+        uint64_t operator*() const { return a->packet_value(o); }
+        iterator& operator++() { o += a->packet_size(o); i++; return *this; }
+        iterator operator++(int) { iterator t = *this; ++*this; return t; }
+        bool operator==(const iterator &b) const { return i == b.i; }
+        bool operator!=(const iterator &b) const { return i != b.i; }
+    };
+
+    iterator begin() const { return iterator{ this, 0, 0 }; }
+    iterator end() const { return iterator{ this, bytes(), count }; }
+};
+
+/*
+ * vlu_select_64 - position of the set bit of rank r in a word
+ */
+#if USE_BMI2
+VLU_TARGET_BMI2
+static inline size_t vlu_select_64_bmi2(uint64_t w, size_t r)
+{
+    return ctz(_pdep_u64(1ull << r, w));
+}
+#endif
+
+static inline size_t vlu_select_64_scalar(uint64_t w, size_t r)
+{
+    for (; r > 0; r--) w &= w - 1;
+    return ctz(w);
 }
+
+static inline size_t vlu_select_64(uint64_t w, size_t r)
+{
+#if USE_BMI2
+    if (vlu_cpu_bmi2()) return vlu_select_64_bmi2(w, r);
 #endif
+    return vlu_select_64_scalar(w, r);
+}
+
+/*
+ * vlu_rank_select - value start bitmap with rank and select
+ *
+ * A bit is set for the first byte of each value in a packed buffer,
+ * which costs one bit per byte. Cumulative counts for each 512-bit
+ * block (one cache line of bits) give rank with one popcount pass over
+ * at most 8 words, and the block holding every 256th value is sampled
+ * for select. Values are 1 to 10 bytes so a block holds at least 51
+ * values, and select scans at most a few block counts before finding
+ * the word with pdep and tzcnt.
+ */
+struct vlu_rank_select
+{
+    static const size_t block_bits = 512;
+    static const size_t select_sample = 256;
+
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> ranks;
+    std::vector<uint32_t> samples;
+    size_t count;
+
+    vlu_rank_select() : count(0) {}
+
+    vlu_rank_select(const uint8_t *src, size_t len) : count(0)
+    {
+        build(src, len);
+    }
+
+    /*
+     * build - mark value starts in a packed buffer
+     *
+     * Continuation intervals are stepped over in the same way as
+     * vlu_items, so only the first byte of a long value is marked.
+     */
+    void build(const uint8_t *src, size_t len)
+    {
+        size_t nwords = (len + block_bits - 1) / block_bits * (block_bits / 64);
+        bits.assign(nwords, 0);
+        count = 0;
 
+        for (size_t i = 0, cont = 0; i < len; ) {
+            uint64_t d = 0;
+            std::memcpy(&d, src + i, std::min((size_t)8, len - i));
+            if (!cont) {
+                bits[i >> 6] |= 1ull << (i & 63);
+                count++;
+            }
+            cont = (d & 0xff) == 0xff;
+            i += vlu_decoded_size_56(d);
+        }
+
+        ranks.resize(nwords / (block_bits / 64) + 1);
+        samples.clear();
+        uint64_t r = 0;
+        for (size_t b = 0; b + 1 < ranks.size(); b++) {
+            ranks[b] = r;
+            for (size_t w = 0; w < block_bits / 64; w++) {
+                uint64_t x = bits[b * (block_bits / 64) + w];
+                size_t c = popcount(x);
+                /* block holding each sampled value */
+                while (samples.size() * select_sample < r + c) {
+                    samples.push_back((uint32_t)b);
+                }
+                r += c;
+            }
+        }
+        ranks.back() = r;
+    }
+
+    /*
+     * size - number of values
+     */
+    size_t size() const
+    {
+        return count;
+    }
+
+    /*
+     * rank - number of values starting before byte pos
+     */
+    size_t rank(size_t pos) const
+    {
+        size_t b = pos / block_bits, w = pos >> 6;
+        if (b + 1 >= ranks.size()) return count;
+        size_t r = ranks[b];
+        for (size_t j = b * (block_bits / 64); j < w; j++) {
+            r += popcount(bits[j]);
+        }
+        return r + popcount(bits[w] & ((1ull << (pos & 63)) - 1));
+    }
+
+    /*
+     * select - byte offset of value i
+     */
+    size_t select(size_t i) const
+    {
+        assert(i < count);
+        size_t b = samples[i / select_sample];
+        while (ranks[b + 1] <= i) b++;
+        size_t r = i - ranks[b];
+        size_t w = b * (block_bits / 64);
+        for (;; w++) {
+            size_t c = popcount(bits[w]);
+            if (r < c) break;
+            r -= c;
+        }
+        return (w << 6) + vlu_select_64(bits[w], r);
+    }
+};
 
 /*
  * leb_encode_56 - LEB128 encoding up to 56-bits
@@ -499,13 +3584,57 @@ static int leb_decoded_size_56(uint64_t leb)
 }
 
 /*
- * leb_size_vec - calculate packed size in bytes
+ * leb_decode_56_bmi2 - LEB128 decoding with pext
+ *
+ * The packet size is found from the first byte with its high bit clear
+ * and the 7-bit groups are extracted from the low bits of each byte
+ * with one instruction.
  */
-static size_t leb_size_vec(std::vector<uint64_t> &vec)
+#if USE_BMI2
+VLU_TARGET_BMI2
+static int leb_decoded_size_56_bmi2(uint64_t leb)
+{
+    return (int)(_tzcnt_u64(~leb & 0x8080808080808080ull) >> 3) + 1;
+}
+
+VLU_TARGET_BMI2
+static vlu_result leb_decode_56_bmi2(uint64_t leb)
+{
+    int shamt = leb_decoded_size_56_bmi2(leb);
+    return vlu_result{ _pext_u64(_bzhi_u64(leb, shamt * 8), 0x7f7f7f7f7f7f7f7full), shamt };
+}
+#endif
+
+/*
+ * leb_step_scalar, leb_step_bmi2 - packet decode steps for the bulk kernels
+ *
+ * Encoding stays scalar: for short packets the branches on the size
+ * predict well and beat computing it for pdep.
+ */
+struct leb_step_scalar
+{
+    static vlu_result decode_56(uint64_t leb) { return leb_decode_56(leb); }
+    static int decoded_size_56(uint64_t leb) { return leb_decoded_size_56(leb); }
+};
+
+#if USE_BMI2
+struct leb_step_bmi2
+{
+    VLU_TARGET_BMI2
+    static vlu_result decode_56(uint64_t leb) { return leb_decode_56_bmi2(leb); }
+    VLU_TARGET_BMI2
+    static int decoded_size_56(uint64_t leb) { return leb_decoded_size_56_bmi2(leb); }
+};
+#endif
+
+/*
+ * leb_size - calculate packed size in bytes
+ */
+static size_t leb_size(const uint64_t *src, size_t n)
 {
     size_t len = 0;
-    for (uint64_t val : vec) {
-        size_t shamt = leb_encoded_size_56(val);
+    for (size_t i = 0; i < n; i++) {
+        size_t shamt = leb_encoded_size_56(src[i]);
         assert(shamt > 0 && shamt < 9);
         len += shamt;
     }
@@ -513,25 +3642,25 @@ static size_t leb_size_vec(std::vector<uint64_t> &vec)
 }
 
 /*
- * leb_size_vec - get size of array
+ * leb_items - get number of packets in buffer
  */
-static size_t leb_items_vec(std::vector<uint8_t> &vec)
+template <typename S>
+static size_t leb_items_kernel(const uint8_t *src, size_t len)
 {
     size_t items = 0;
-    size_t l = vec.size();
-    for (size_t i = 0 ; i < l;) {
+    for (size_t i = 0 ; i < len;) {
         uint64_t d = 0;
-        size_t s = std::min((size_t)8,l-i);
+        size_t s = std::min((size_t)8,len-i);
         switch (s) {
-        case 1: d = *reinterpret_cast<uint8_t*>(&vec[i]); break;
-        case 2: d = *reinterpret_cast<uint16_t*>(&vec[i]); break;
-        case 3: std::memcpy(&d, &vec[i], s); break;
-        case 4: d = *reinterpret_cast<uint32_t*>(&vec[i]); break;
-        case 5: case 6: case 7: std::memcpy(&d, &vec[i], s); break;
-        case 8: d = *reinterpret_cast<uint64_t*>(&vec[i]); break;
-        default: std::memcpy(&d, &vec[i], s); break;
-        }
-        size_t shamt = leb_decoded_size_56(d);
+        case 1: d = *reinterpret_cast<const uint8_t*>(src + i); break;
+        case 2: d = *reinterpret_cast<const uint16_t*>(src + i); break;
+        case 3: std::memcpy(&d, src + i, s); break;
+        case 4: d = *reinterpret_cast<const uint32_t*>(src + i); break;
+        case 5: case 6: case 7: std::memcpy(&d, src + i, s); break;
+        case 8: d = *reinterpret_cast<const uint64_t*>(src + i); break;
+        default: std::memcpy(&d, src + i, s); break;
+        }
+        size_t shamt = S::decoded_size_56(d);
         assert(shamt > 0 && shamt < 9);
         i += shamt;
         items++;
@@ -539,64 +3668,145 @@ static size_t leb_items_vec(std::vector<uint8_t> &vec)
     return items;
 }
 
+#if USE_BMI2
+VLU_TARGET_BMI2 VLU_FLATTEN
+static size_t leb_items_bmi2(const uint8_t *src, size_t len)
+{
+    return leb_items_kernel<leb_step_bmi2>(src, len);
+}
+#endif
+
+static size_t leb_items(const uint8_t *src, size_t len)
+{
+#if USE_BMI2
+    if (vlu_cpu_bmi2()) return leb_items_bmi2(src, len);
+#endif
+    return leb_items_kernel<leb_step_scalar>(src, len);
+}
+
 /*
- * leb_encode_vec - encode array
+ * leb_encode - encode array into buffer
+ *
+ * returns {
+ *   nread:    number of values encoded
+ *   nwritten: number of bytes written
+ * }
  */
-static void leb_encode_vec(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+static vlu_io_result leb_encode(uint8_t *dst, size_t cap, const uint64_t *src, size_t n)
 {
-    size_t l = src.size();
-    size_t o = 0;
-
-    size_t items = leb_size_vec(src);
-    dst.resize(items);
+    size_t i = 0, o = 0;
 
-    for (uint64_t v : src)
+    for (; i < n; i++)
     {
-        vlu_result r = leb_encode_56(v);
+        vlu_result r = leb_encode_56(src[i]);
+        assert(r.shamt > 0 && r.shamt < 9);
+        if (o + r.shamt > cap) break;
         switch (r.shamt) {
-        case 1: *reinterpret_cast<uint8_t*>(&dst[o]) = (uint8_t)r.val; break;
-        case 2: *reinterpret_cast<uint16_t*>(&dst[o]) = (uint16_t)r.val; break;
-        case 3: std::memcpy(&dst[o], &r.val, r.shamt); break;
-        case 4: *reinterpret_cast<uint32_t*>(&dst[o]) = (uint32_t)r.val; break;
-        case 5: case 6: case 7: std::memcpy(&dst[o], &r.val, r.shamt); break;
-        case 8: *reinterpret_cast<uint64_t*>(&dst[o]) = r.val; break;
-        default: std::memcpy(&dst[o], &r.val, r.shamt); break;
+        case 1: *reinterpret_cast<uint8_t*>(dst + o) = (uint8_t)r.val; break;
+        case 2: *reinterpret_cast<uint16_t*>(dst + o) = (uint16_t)r.val; break;
+        case 3: std::memcpy(dst + o, &r.val, r.shamt); break;
+        case 4: *reinterpret_cast<uint32_t*>(dst + o) = (uint32_t)r.val; break;
+        case 5: case 6: case 7: std::memcpy(dst + o, &r.val, r.shamt); break;
+        case 8: *reinterpret_cast<uint64_t*>(dst + o) = r.val; break;
+        default: std::memcpy(dst + o, &r.val, r.shamt); break;
         }
-        assert(r.shamt > 0 && r.shamt < 9);
         o += r.shamt;
     }
+
+    return vlu_io_result{ i, o };
 }
 
 /*
- * leb_decode_vec - decode array
+ * leb_decode - decode buffer into array
+ *
+ * returns {
+ *   nread:    number of bytes consumed
+ *   nwritten: number of values decoded
+ * }
  */
-static void leb_decode_vec(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+template <typename S>
+static vlu_io_result leb_decode_kernel(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
 {
-    size_t l = src.size();
     size_t i = 0, o = 0;
 
-    size_t items = leb_items_vec(src);
-    dst.resize(items);
-
-    for (; i < l - 8; )  {
-        uint64_t d = *reinterpret_cast<uint64_t*>(&src[i]);
-        vlu_result r = leb_decode_56(d);
+    for (; i + 8 <= len && o < cap; )  {
+        uint64_t d = *reinterpret_cast<const uint64_t*>(src + i);
+        vlu_result r = S::decode_56(d);
         assert(r.shamt > 0);
-        assert(o < items);
         dst[o] = r.val;
         i += r.shamt;
         o++;
     }
 
-    for (; i < l; ) {
+    for (; i < len && o < cap; ) {
         uint64_t d = 0;
-        size_t s = std::min((size_t)8,l-i);
-        std::memcpy(&d, &src[i], s);
-        vlu_result r = leb_decode_56(d);
+        size_t s = std::min((size_t)8,len-i);
+        std::memcpy(&d, src + i, s);
+        vlu_result r = S::decode_56(d);
         assert(r.shamt > 0);
-        assert(o < items);
+        if ((size_t)r.shamt > s) break;
         dst[o] = r.val;
         i += r.shamt;
         o++;
     }
+
+    return vlu_io_result{ i, o };
+}
+
+#if USE_BMI2
+VLU_TARGET_BMI2 VLU_FLATTEN
+static vlu_io_result leb_decode_bmi2(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+    return leb_decode_kernel<leb_step_bmi2>(dst, cap, src, len);
+}
+#endif
+
+static vlu_io_result leb_decode(uint64_t *dst, size_t cap, const uint8_t *src, size_t len)
+{
+#if USE_BMI2
+    if (vlu_cpu_bmi2()) return leb_decode_bmi2(dst, cap, src, len);
+#endif
+    return leb_decode_kernel<leb_step_scalar>(dst, cap, src, len);
+}
+
+/*
+ * leb_size_vec - calculate packed size in bytes
+ */
+static size_t leb_size_vec(std::vector<uint64_t> &vec)
+{
+    return leb_size(vec.data(), vec.size());
+}
+
+/*
+ * leb_size_vec - get size of array
+ */
+static size_t leb_items_vec(std::vector<uint8_t> &vec)
+{
+    return leb_items(vec.data(), vec.size());
+}
+
+/*
+ * leb_encode_vec - encode array
+ */
+static void leb_encode_vec(std::vector<uint8_t> &dst, std::vector<uint64_t> &src)
+{
+    size_t size = leb_size(src.data(), src.size());
+    dst.resize(size);
+
+    vlu_io_result r = leb_encode(dst.data(), size, src.data(), src.size());
+    assert(r.nread == src.size());
+    (void)r;
+}
+
+/*
+ * leb_decode_vec - decode array
+ */
+static void leb_decode_vec(std::vector<uint64_t> &dst, std::vector<uint8_t> &src)
+{
+    size_t items = leb_items(src.data(), src.size());
+    dst.resize(items);
+
+    vlu_io_result r = leb_decode(dst.data(), items, src.data(), src.size());
+    assert(r.nwritten == items);
+    (void)r;
 }
@@ -36,6 +36,8 @@
 #include <sstream>
 
 #include "vlu.h"
+#include "vlu_parallel.h"
+#include "vlu_codec.h"
 
 /*
  * random numbers
@@ -70,6 +72,28 @@ struct bench_random
         /* (p=0.125 for each size) randomly choose 1 to 8 bytes */
         return val >> ((val & 0x7) << 3);
     }
+
+    uint64_t pure_64() {
+        /* random numbers from 0 - 2^64-1 */
+        return random_dist_56(random_engine) << 8 | random_dist_8(random_engine);
+    }
+
+    int64_t signed_8() {
+        /* random numbers from -2^7 - 2^7-1 */
+        return (int8_t)random_dist_8(random_engine);
+    }
+
+    int64_t signed_56() {
+        /* random numbers from -2^55 - 2^55-1 */
+        return (int64_t)(random_dist_56(random_engine) << 8) >> 8;
+    }
+
+    int64_t signed_mix() {
+        /* random numbers from -2^55 - 2^55-1 */
+        uint64_t val = random_dist_56(random_engine);
+        /* (p=0.125 for each size) randomly choose 1 to 8 bytes */
+        return (int64_t)(val << 8) >> (8 + ((val & 0x7) << 3));
+    }
 };
 
 /*
@@ -87,6 +111,17 @@ struct bench_context
     std::vector<uint64_t> out;
     std::vector<std::unique_ptr<char>> strbuf;
     std::vector<uint8_t> vbuf;
+    std::vector<vlu_u128> in_112;
+    std::vector<vlu_u128> out_112;
+    std::vector<int64_t> in_s;
+    std::vector<int64_t> out_s;
+    std::vector<size_t> idx;
+    vlu_array arr;
+    vlu_rank_select rs;
+    std::vector<vlu_batch_encode_job> ejobs;
+    std::vector<vlu_batch_decode_job> djobs;
+    std::vector<std::vector<uint8_t>> packed;
+    std::vector<std::vector<uint64_t>> unpacked;
     bench_random random;
 
     bench_context(std::string name, size_t item_count, size_t runs, size_t iterations) :
@@ -114,6 +149,10 @@ static std::unique_ptr<char> make_string(uint64_t val, const char* fmt)
 static uint64_t random_8(bench_context &ctx) { return ctx.random.pure_8(); }
 static uint64_t random_56(bench_context &ctx) { return ctx.random.pure_56(); }
 static uint64_t random_mix(bench_context &ctx) { return ctx.random.mix_56(); }
+static uint64_t random_64(bench_context &ctx) { return ctx.random.pure_64(); }
+static uint64_t random_s8(bench_context &ctx) { return ctx.random.signed_8(); }
+static uint64_t random_s56(bench_context &ctx) { return ctx.random.signed_56(); }
+static uint64_t random_smix(bench_context &ctx) { return ctx.random.signed_mix(); }
 
 
 /*
@@ -184,6 +223,190 @@ static void setup_vec(bench_context &ctx, uint64_t(*rnd)(bench_context&))
     vlu_encode_vec(ctx.vbuf, ctx.in);
 }
 
+static void setup_dfl_112(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    /* half as many 128-bit items, with the high word up to 48 bits */
+    ctx.in_112.resize(ctx.item_count / 2);
+    ctx.out_112.resize(ctx.item_count / 2);
+    for (size_t i = 0; i < ctx.item_count / 2; i++) {
+        ctx.in_112[i].lo = rnd(ctx);
+        ctx.in_112[i].hi = rnd(ctx) >> 8;
+    }
+}
+
+static void setup_vec_112(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_dfl_112(ctx, rnd);
+    vlu_encode_vec_112(ctx.vbuf, ctx.in_112);
+}
+
+static void setup_dfl_s(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    ctx.in_s.resize(ctx.item_count);
+    ctx.out_s.resize(ctx.item_count);
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.in_s[i] = (int64_t)rnd(ctx);
+    }
+}
+
+static void setup_vec_s(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_dfl_s(ctx, rnd);
+    svlu_encode_vec(ctx.vbuf, ctx.in_s);
+}
+
+static void setup_sorted(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    /* sorted ids with random gaps */
+    ctx.in.resize(ctx.item_count);
+    ctx.out.resize(ctx.item_count);
+    uint64_t val = 0;
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.in[i] = val += rnd(ctx);
+    }
+}
+
+static void setup_timestamp(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    /* nanosecond timestamps at 1 millisecond intervals with jitter */
+    ctx.in.resize(ctx.item_count);
+    ctx.out.resize(ctx.item_count);
+    const uint64_t start = 1600000000000000000ull, interval = 1000000;
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.in[i] = start + i * interval + rnd(ctx);
+    }
+}
+
+static void setup_sorted_delta(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_sorted(ctx, rnd);
+    vlu_encode_vec_delta(ctx.vbuf, ctx.in);
+}
+
+static void setup_timestamp_delta(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_timestamp(ctx, rnd);
+    vlu_encode_vec_delta(ctx.vbuf, ctx.in);
+}
+
+static void setup_timestamp_dod(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_timestamp(ctx, rnd);
+    vlu_encode_vec_dod(ctx.vbuf, ctx.in);
+}
+
+static void setup_window(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    /* 48-bit offsets within a 1 MiB window that moves every 4096 values */
+    ctx.in.resize(ctx.item_count);
+    ctx.out.resize(ctx.item_count);
+    uint64_t base = 0;
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        if (i % 4096 == 0) base = rnd(ctx) >> 8;
+        ctx.in[i] = base + (rnd(ctx) & 0xfffff);
+    }
+}
+
+static void setup_window_vec(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_window(ctx, rnd);
+    vlu_encode_vec(ctx.vbuf, ctx.in);
+}
+
+static void setup_window_for_128(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_window(ctx, rnd);
+    vlu_encode_vec_for(ctx.vbuf, ctx.in, 128);
+}
+
+static void setup_window_for_1024(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_window(ctx, rnd);
+    vlu_encode_vec_for(ctx.vbuf, ctx.in, 1024);
+}
+
+template <typename C>
+static void setup_codec(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_dfl(ctx, rnd);
+    C::encode_vec(ctx.vbuf, ctx.in);
+}
+
+static void setup_vec_group(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_dfl(ctx, rnd);
+    vlu_encode_vec_group(ctx.vbuf, ctx.in);
+}
+
+static void setup_array(bench_context &ctx, uint64_t(*rnd)(bench_context&), size_t sample)
+{
+    setup_dfl(ctx, rnd);
+    ctx.arr = vlu_array(ctx.in, sample);
+    ctx.idx.resize(ctx.item_count);
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.idx[i] = ctx.random.pure_56() % ctx.item_count;
+    }
+}
+
+static void setup_array_16(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_array(ctx, rnd, 16);
+}
+
+static void setup_array_64(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_array(ctx, rnd, 64);
+}
+
+static void setup_select(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    setup_array(ctx, rnd, 64);
+    vlu_encode_vec(ctx.vbuf, ctx.in);
+    ctx.rs.build(ctx.vbuf.data(), ctx.vbuf.size());
+}
+
+static void setup_batch(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    /* split the input into arrays of 10 to 1000 values */
+    setup_dfl(ctx, rnd);
+    std::vector<size_t> split(1, 0);
+    while (split.back() < ctx.item_count) {
+        size_t n = 10 + ctx.random.pure_56() % 991;
+        split.push_back(std::min(split.back() + n, ctx.item_count));
+    }
+    size_t jobs = split.size() - 1;
+    ctx.packed.resize(jobs);
+    ctx.unpacked.resize(jobs);
+    for (size_t j = 0; j < jobs; j++) {
+        ctx.ejobs.push_back(vlu_batch_encode_job{
+            ctx.in.data() + split[j], split[j + 1] - split[j], &ctx.packed[j] });
+    }
+    vlu_encode_batch(ctx.ejobs);
+    for (size_t j = 0; j < jobs; j++) {
+        ctx.djobs.push_back(vlu_batch_decode_job{
+            ctx.packed[j].data(), ctx.packed[j].size(), &ctx.unpacked[j] });
+    }
+}
+
+static const size_t bench_big_limbs = 64; /* 4096-bit integers */
+
+static void setup_big(bench_context &ctx, uint64_t(*rnd)(bench_context&))
+{
+    ctx.in.resize(ctx.item_count);
+    ctx.out.resize(ctx.item_count);
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.in[i] = rnd(ctx) << 8 | (rnd(ctx) & 0xff);
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < ctx.item_count; i += bench_big_limbs) {
+        len += vlu_encoded_size_big(&ctx.in[i], bench_big_limbs);
+    }
+    ctx.vbuf.resize(len);
+    for (size_t i = 0, o = 0; i < ctx.item_count; i += bench_big_limbs) {
+        o += vlu_encode_big(&ctx.vbuf[o], len - o, &ctx.in[i], bench_big_limbs).nwritten;
+    }
+}
+
 
 /*
  * benchmarks
@@ -262,6 +485,181 @@ static void bench_vlu_decode_vec(bench_context &ctx)
     vlu_decode_vec(ctx.out, ctx.vbuf);
 }
 
+static void bench_vlu_items_vec(bench_context &ctx)
+{
+    ctx.out.resize(1);
+    ctx.out[0] = vlu_items_vec(ctx.vbuf);
+}
+
+#if USE_AVX2
+static void bench_vlu_decode_vec_avx2(bench_context &ctx)
+{
+    vlu_decode_vec_avx2(ctx.out, ctx.vbuf);
+}
+#endif
+
+#if USE_AVX512_VBMI2
+static void bench_vlu_encode_vec_avx512(bench_context &ctx)
+{
+    vlu_encode_vec_avx512(ctx.vbuf, ctx.in);
+}
+
+static void bench_vlu_decode_vec_avx512(bench_context &ctx)
+{
+    vlu_decode_vec_avx512(ctx.out, ctx.vbuf);
+}
+#endif
+
+static void bench_vlu_encode_vec_112(bench_context &ctx)
+{
+    vlu_encode_vec_112(ctx.vbuf, ctx.in_112);
+}
+
+static void bench_vlu_decode_vec_112(bench_context &ctx)
+{
+    vlu_decode_vec_112(ctx.out_112, ctx.vbuf);
+}
+
+static void bench_vlu_encode_big(bench_context &ctx)
+{
+    size_t len = ctx.vbuf.size();
+    for (size_t i = 0, o = 0; i < ctx.item_count; i += bench_big_limbs) {
+        o += vlu_encode_big(&ctx.vbuf[o], len - o, &ctx.in[i], bench_big_limbs).nwritten;
+    }
+}
+
+static void bench_vlu_decode_big(bench_context &ctx)
+{
+    size_t len = ctx.vbuf.size();
+    for (size_t i = 0, o = 0; i < ctx.item_count; i += bench_big_limbs) {
+        o += vlu_decode_big(&ctx.out[i], bench_big_limbs, &ctx.vbuf[o], len - o).nread;
+    }
+}
+
+static void bench_svlu_encode_vec(bench_context &ctx)
+{
+    svlu_encode_vec(ctx.vbuf, ctx.in_s);
+}
+
+static void bench_svlu_decode_vec(bench_context &ctx)
+{
+    svlu_decode_vec(ctx.out_s, ctx.vbuf);
+}
+
+static void bench_vlu_encode_vec_delta(bench_context &ctx)
+{
+    vlu_encode_vec_delta(ctx.vbuf, ctx.in);
+}
+
+static void bench_vlu_decode_vec_delta(bench_context &ctx)
+{
+    vlu_decode_vec_delta(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_encode_vec_dod(bench_context &ctx)
+{
+    vlu_encode_vec_dod(ctx.vbuf, ctx.in);
+}
+
+static void bench_vlu_decode_vec_dod(bench_context &ctx)
+{
+    vlu_decode_vec_dod(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_encode_vec_for_128(bench_context &ctx)
+{
+    vlu_encode_vec_for(ctx.vbuf, ctx.in, 128);
+}
+
+static void bench_vlu_encode_vec_for_1024(bench_context &ctx)
+{
+    vlu_encode_vec_for(ctx.vbuf, ctx.in, 1024);
+}
+
+static void bench_vlu_decode_vec_for(bench_context &ctx)
+{
+    vlu_decode_vec_for(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_encode_vec_group(bench_context &ctx)
+{
+    vlu_encode_vec_group(ctx.vbuf, ctx.in);
+}
+
+static void bench_vlu_decode_vec_group(bench_context &ctx)
+{
+    vlu_decode_vec_group(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_array_lookup(bench_context &ctx)
+{
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        ctx.out[i] = ctx.arr[ctx.idx[i]];
+    }
+}
+
+static void bench_vlu_array_iterate(bench_context &ctx)
+{
+    size_t i = 0;
+    for (uint64_t v : ctx.arr) {
+        ctx.out[i++] = v;
+    }
+}
+
+static void bench_vlu_select_lookup(bench_context &ctx)
+{
+    const uint8_t *s = ctx.vbuf.data();
+    size_t l = ctx.vbuf.size();
+    for (size_t i = 0; i < ctx.item_count; i++) {
+        size_t o = ctx.rs.select(ctx.idx[i]);
+        vlu_decode(&ctx.out[i], 1, s + o, l - o);
+    }
+}
+
+static void bench_vlu_skip(bench_context &ctx)
+{
+    const uint8_t *s = ctx.vbuf.data(), *e = s + ctx.vbuf.size();
+    ctx.out.resize(1);
+    ctx.out[0] = vlu_skip(s, e, ctx.item_count) - s;
+}
+
+static void bench_vlu_encode_vec_parallel(bench_context &ctx)
+{
+    vlu_encode_vec_parallel(ctx.vbuf, ctx.in);
+}
+
+static void bench_vlu_decode_vec_parallel(bench_context &ctx)
+{
+    vlu_decode_vec_parallel(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_decode_vec_checked(bench_context &ctx)
+{
+    vlu_decode_vec_checked(ctx.out, ctx.vbuf);
+}
+
+static void bench_vlu_encode_batch(bench_context &ctx)
+{
+    vlu_encode_batch(ctx.ejobs);
+}
+
+static void bench_vlu_decode_batch(bench_context &ctx)
+{
+    vlu_decode_batch(ctx.djobs);
+}
+
+template <typename C>
+static void bench_codec_encode_vec(bench_context &ctx)
+{
+    C::encode_vec(ctx.vbuf, ctx.in);
+}
+
+template <typename C>
+static void bench_codec_decode_vec(bench_context &ctx)
+{
+    C::decode_vec(ctx.out, ctx.vbuf);
+}
+
 static void bench_leb_encode_vec(bench_context &ctx)
 {
     leb_encode_vec(ctx.vbuf, ctx.in);
@@ -347,6 +745,20 @@ static int bench_exec(C &&ctx, S setup, R random, B bench)
 template<typename C>
 int run_benchmark(size_t item_count, size_t benchmark, size_t runs, size_t iterations)
 {
+#if USE_AVX2
+    /* skip the AVX2 benchmarks on processors without AVX2 */
+    if (((benchmark >= 37 && benchmark <= 39) || benchmark == 59) && !vlu_cpu_avx2()) {
+        return 0;
+    }
+#endif
+#if USE_AVX512_VBMI2
+    /* skip the AVX-512 benchmarks on processors without VBMI2 */
+    if (((benchmark >= 40 && benchmark <= 45) || benchmark == 60 || benchmark == 61) &&
+        !vlu_cpu_avx512vbmi2()) {
+        return 0;
+    }
+#endif
+
     switch (benchmark) {
     case 0:  return bench_exec(C("BARE",                            item_count, runs, iterations), setup_dfl,  random_56,  bench_nop        );
     case 1:  return bench_exec(C("LEB_56-raw encode (random-8)",    item_count, runs, iterations), setup_dfl,  random_8,   bench_leb_encode_56);
@@ -385,6 +797,91 @@ int run_benchmark(size_t item_count, size_t benchmark, size_t runs, size_t itera
     case 34: return bench_exec(C("strtoull/16 decode (random-8)",   item_count, runs, iterations), setup_hex,  random_8,   bench_strtoull_hex_decode_56);
     case 35: return bench_exec(C("strtoull/16 decode (random-56)",  item_count, runs, iterations), setup_hex,  random_56,  bench_strtoull_hex_decode_56);
     case 36: return bench_exec(C("strtoull/16 decode (random-mix)", item_count, runs, iterations), setup_hex,  random_mix, bench_strtoull_hex_decode_56);
+#if USE_AVX2
+    case 37: return bench_exec(C("VLU_56-avx2 decode (random-8)",   item_count, runs, iterations), setup_vec,  random_8,   bench_vlu_decode_vec_avx2);
+    case 38: return bench_exec(C("VLU_56-avx2 decode (random-56)",  item_count, runs, iterations), setup_vec,  random_56,  bench_vlu_decode_vec_avx2);
+    case 39: return bench_exec(C("VLU_56-avx2 decode (random-mix)", item_count, runs, iterations), setup_vec,  random_mix, bench_vlu_decode_vec_avx2);
+#endif
+#if USE_AVX512_VBMI2
+    case 40: return bench_exec(C("VLU_56-vbmi2 encode (random-8)",   item_count, runs, iterations), setup_dfl,  random_8,   bench_vlu_encode_vec_avx512);
+    case 41: return bench_exec(C("VLU_56-vbmi2 encode (random-56)",  item_count, runs, iterations), setup_dfl,  random_56,  bench_vlu_encode_vec_avx512);
+    case 42: return bench_exec(C("VLU_56-vbmi2 encode (random-mix)", item_count, runs, iterations), setup_dfl,  random_mix, bench_vlu_encode_vec_avx512);
+    case 43: return bench_exec(C("VLU_56-vbmi2 decode (random-8)",   item_count, runs, iterations), setup_vec,  random_8,   bench_vlu_decode_vec_avx512);
+    case 44: return bench_exec(C("VLU_56-vbmi2 decode (random-56)",  item_count, runs, iterations), setup_vec,  random_56,  bench_vlu_decode_vec_avx512);
+    case 45: return bench_exec(C("VLU_56-vbmi2 decode (random-mix)", item_count, runs, iterations), setup_vec,  random_mix, bench_vlu_decode_vec_avx512);
+#endif
+    case 46: return bench_exec(C("VLU_56-pack count (random-8)",    item_count, runs, iterations), setup_vec,  random_8,   bench_vlu_items_vec);
+    case 47: return bench_exec(C("VLU_56-pack count (random-56)",   item_count, runs, iterations), setup_vec,  random_56,  bench_vlu_items_vec);
+    case 48: return bench_exec(C("VLU_56-pack count (random-mix)",  item_count, runs, iterations), setup_vec,  random_mix, bench_vlu_items_vec);
+    case 49: return bench_exec(C("VLU_112-pack encode (random-8)",  item_count, runs, iterations), setup_dfl_112, random_8,   bench_vlu_encode_vec_112);
+    case 50: return bench_exec(C("VLU_112-pack encode (random-56)", item_count, runs, iterations), setup_dfl_112, random_56,  bench_vlu_encode_vec_112);
+    case 51: return bench_exec(C("VLU_112-pack encode (random-mix)",item_count, runs, iterations), setup_dfl_112, random_mix, bench_vlu_encode_vec_112);
+    case 52: return bench_exec(C("VLU_112-pack decode (random-8)",  item_count, runs, iterations), setup_vec_112, random_8,   bench_vlu_decode_vec_112);
+    case 53: return bench_exec(C("VLU_112-pack decode (random-56)", item_count, runs, iterations), setup_vec_112, random_56,  bench_vlu_decode_vec_112);
+    case 54: return bench_exec(C("VLU_112-pack decode (random-mix)",item_count, runs, iterations), setup_vec_112, random_mix, bench_vlu_decode_vec_112);
+    case 55: return bench_exec(C("VLU_big encode (4096-bit)",       item_count, runs, iterations), setup_big, random_56, bench_vlu_encode_big);
+    case 56: return bench_exec(C("VLU_big decode (4096-bit)",       item_count, runs, iterations), setup_big, random_56, bench_vlu_decode_big);
+    case 57: return bench_exec(C("VLU_64-pack encode (random-64)",  item_count, runs, iterations), setup_dfl,  random_64,  bench_vlu_encode_vec);
+    case 58: return bench_exec(C("VLU_64-pack decode (random-64)",  item_count, runs, iterations), setup_vec,  random_64,  bench_vlu_decode_vec);
+#if USE_AVX2
+    case 59: return bench_exec(C("VLU_64-avx2 decode (random-64)",  item_count, runs, iterations), setup_vec,  random_64,  bench_vlu_decode_vec_avx2);
+#endif
+#if USE_AVX512_VBMI2
+    case 60: return bench_exec(C("VLU_64-vbmi2 encode (random-64)", item_count, runs, iterations), setup_dfl,  random_64,  bench_vlu_encode_vec_avx512);
+    case 61: return bench_exec(C("VLU_64-vbmi2 decode (random-64)", item_count, runs, iterations), setup_vec,  random_64,  bench_vlu_decode_vec_avx512);
+#endif
+    case 62: return bench_exec(C("SVLU-pack encode (random-s8)",    item_count, runs, iterations), setup_dfl_s, random_s8,   bench_svlu_encode_vec);
+    case 63: return bench_exec(C("SVLU-pack encode (random-s56)",   item_count, runs, iterations), setup_dfl_s, random_s56,  bench_svlu_encode_vec);
+    case 64: return bench_exec(C("SVLU-pack encode (random-smix)",  item_count, runs, iterations), setup_dfl_s, random_smix, bench_svlu_encode_vec);
+    case 65: return bench_exec(C("SVLU-pack decode (random-s8)",    item_count, runs, iterations), setup_vec_s, random_s8,   bench_svlu_decode_vec);
+    case 66: return bench_exec(C("SVLU-pack decode (random-s56)",   item_count, runs, iterations), setup_vec_s, random_s56,  bench_svlu_decode_vec);
+    case 67: return bench_exec(C("SVLU-pack decode (random-smix)",  item_count, runs, iterations), setup_vec_s, random_smix, bench_svlu_decode_vec);
+    case 68: return bench_exec(C("VLU-delta encode (sorted)",       item_count, runs, iterations), setup_sorted,          random_8, bench_vlu_encode_vec_delta);
+    case 69: return bench_exec(C("VLU-delta decode (sorted)",       item_count, runs, iterations), setup_sorted_delta,    random_8, bench_vlu_decode_vec_delta);
+    case 70: return bench_exec(C("VLU-delta encode (timestamp)",    item_count, runs, iterations), setup_timestamp,       random_8, bench_vlu_encode_vec_delta);
+    case 71: return bench_exec(C("VLU-delta decode (timestamp)",    item_count, runs, iterations), setup_timestamp_delta, random_8, bench_vlu_decode_vec_delta);
+    case 72: return bench_exec(C("VLU-dod encode (timestamp)",      item_count, runs, iterations), setup_timestamp,       random_8, bench_vlu_encode_vec_dod);
+    case 73: return bench_exec(C("VLU-dod decode (timestamp)",      item_count, runs, iterations), setup_timestamp_dod,   random_8, bench_vlu_decode_vec_dod);
+    case 74: return bench_exec(C("VLU_56-pack encode (window)",     item_count, runs, iterations), setup_window,          random_56, bench_vlu_encode_vec);
+    case 75: return bench_exec(C("VLU_56-pack decode (window)",     item_count, runs, iterations), setup_window_vec,      random_56, bench_vlu_decode_vec);
+    case 76: return bench_exec(C("VLU-for/128 encode (window)",     item_count, runs, iterations), setup_window,          random_56, bench_vlu_encode_vec_for_128);
+    case 77: return bench_exec(C("VLU-for/128 decode (window)",     item_count, runs, iterations), setup_window_for_128,  random_56, bench_vlu_decode_vec_for);
+    case 78: return bench_exec(C("VLU-for/1024 encode (window)",    item_count, runs, iterations), setup_window,          random_56, bench_vlu_encode_vec_for_1024);
+    case 79: return bench_exec(C("VLU-for/1024 decode (window)",    item_count, runs, iterations), setup_window_for_1024, random_56, bench_vlu_decode_vec_for);
+    case 80: return bench_exec(C("VLU_56-group encode (random-8)",  item_count, runs, iterations), setup_dfl,       random_8,   bench_vlu_encode_vec_group);
+    case 81: return bench_exec(C("VLU_56-group encode (random-56)", item_count, runs, iterations), setup_dfl,       random_56,  bench_vlu_encode_vec_group);
+    case 82: return bench_exec(C("VLU_56-group encode (random-mix)",item_count, runs, iterations), setup_dfl,       random_mix, bench_vlu_encode_vec_group);
+    case 83: return bench_exec(C("VLU_56-group decode (random-8)",  item_count, runs, iterations), setup_vec_group, random_8,   bench_vlu_decode_vec_group);
+    case 84: return bench_exec(C("VLU_56-group decode (random-56)", item_count, runs, iterations), setup_vec_group, random_56,  bench_vlu_decode_vec_group);
+    case 85: return bench_exec(C("VLU_56-group decode (random-mix)",item_count, runs, iterations), setup_vec_group, random_mix, bench_vlu_decode_vec_group);
+    case 86: return bench_exec(C("VLU-array/16 lookup (random-mix)",item_count, runs, iterations), setup_array_16,  random_mix, bench_vlu_array_lookup);
+    case 87: return bench_exec(C("VLU-array/64 lookup (random-mix)",item_count, runs, iterations), setup_array_64,  random_mix, bench_vlu_array_lookup);
+    case 88: return bench_exec(C("VLU-array iterate (random-mix)",  item_count, runs, iterations), setup_array_64,  random_mix, bench_vlu_array_iterate);
+    case 89: return bench_exec(C("VLU-select lookup (random-mix)",  item_count, runs, iterations), setup_select,    random_mix, bench_vlu_select_lookup);
+    case 90: return bench_exec(C("VLU_56-pack skip (random-8)",     item_count, runs, iterations), setup_vec,       random_8,   bench_vlu_skip);
+    case 91: return bench_exec(C("VLU_56-pack skip (random-56)",    item_count, runs, iterations), setup_vec,       random_56,  bench_vlu_skip);
+    case 92: return bench_exec(C("VLU_56-pack skip (random-mix)",   item_count, runs, iterations), setup_vec,       random_mix, bench_vlu_skip);
+    case 93: return bench_exec(C("VLU_56-par encode (random-8)",    item_count, runs, iterations), setup_dfl,       random_8,   bench_vlu_encode_vec_parallel);
+    case 94: return bench_exec(C("VLU_56-par encode (random-56)",   item_count, runs, iterations), setup_dfl,       random_56,  bench_vlu_encode_vec_parallel);
+    case 95: return bench_exec(C("VLU_56-par encode (random-mix)",  item_count, runs, iterations), setup_dfl,       random_mix, bench_vlu_encode_vec_parallel);
+    case 96: return bench_exec(C("VLU_56-par decode (random-8)",    item_count, runs, iterations), setup_vec,       random_8,   bench_vlu_decode_vec_parallel);
+    case 97: return bench_exec(C("VLU_56-par decode (random-56)",   item_count, runs, iterations), setup_vec,       random_56,  bench_vlu_decode_vec_parallel);
+    case 98: return bench_exec(C("VLU_56-par decode (random-mix)",  item_count, runs, iterations), setup_vec,       random_mix, bench_vlu_decode_vec_parallel);
+    case 99: return bench_exec(C("VLU_56-batch encode (random-8)",  item_count, runs, iterations), setup_batch,     random_8,   bench_vlu_encode_batch);
+    case 100: return bench_exec(C("VLU_56-batch encode (random-56)", item_count, runs, iterations), setup_batch,    random_56,  bench_vlu_encode_batch);
+    case 101: return bench_exec(C("VLU_56-batch encode (random-mix)", item_count, runs, iterations), setup_batch,   random_mix, bench_vlu_encode_batch);
+    case 102: return bench_exec(C("VLU_56-batch decode (random-8)", item_count, runs, iterations), setup_batch,     random_8,   bench_vlu_decode_batch);
+    case 103: return bench_exec(C("VLU_56-batch decode (random-56)", item_count, runs, iterations), setup_batch,    random_56,  bench_vlu_decode_batch);
+    case 104: return bench_exec(C("VLU_56-batch decode (random-mix)", item_count, runs, iterations), setup_batch,   random_mix, bench_vlu_decode_batch);
+    case 105: return bench_exec(C("VLU4-codec encode (random-8)",    item_count, runs, iterations), setup_dfl,                random_8,   bench_codec_encode_vec<vlu4_codec>);
+    case 106: return bench_exec(C("VLU4-codec decode (random-8)",    item_count, runs, iterations), setup_codec<vlu4_codec>,  random_8,   bench_codec_decode_vec<vlu4_codec>);
+    case 107: return bench_exec(C("VLU8-codec encode (random-mix)",  item_count, runs, iterations), setup_dfl,                random_mix, bench_codec_encode_vec<vlu8_codec>);
+    case 108: return bench_exec(C("VLU8-codec decode (random-mix)",  item_count, runs, iterations), setup_codec<vlu8_codec>,  random_mix, bench_codec_decode_vec<vlu8_codec>);
+    case 109: return bench_exec(C("VLU16-codec encode (random-mix)", item_count, runs, iterations), setup_dfl,                random_mix, bench_codec_encode_vec<vlu16_codec>);
+    case 110: return bench_exec(C("VLU16-codec decode (random-mix)", item_count, runs, iterations), setup_codec<vlu16_codec>, random_mix, bench_codec_decode_vec<vlu16_codec>);
+    case 111: return bench_exec(C("VLU_56-chk decode (random-8)",    item_count, runs, iterations), setup_vec,                random_8,   bench_vlu_decode_vec_checked);
+    case 112: return bench_exec(C("VLU_56-chk decode (random-56)",   item_count, runs, iterations), setup_vec,                random_56,  bench_vlu_decode_vec_checked);
+    case 113: return bench_exec(C("VLU_56-chk decode (random-mix)",  item_count, runs, iterations), setup_vec,                random_mix, bench_vlu_decode_vec_checked);
     }
 
     return 0;
@@ -0,0 +1,299 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (C) 2019, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "vlu.h"
+
+/*
+ * Parameterized VLU coding
+ *
+ * vlu_codec<BitsPerUnit, PrefixLimit, Word> implements the general
+ * scheme with every parameter a compile time constant. A packet of n
+ * units holds n * (BitsPerUnit - 1) data bits after a unary prefix of
+ * n bits. A prefix of PrefixLimit ones marks a continuation interval
+ * of PrefixLimit units holding the low bits of the value, and the
+ * following interval holds the remaining bits. Intervals are loaded
+ * and stored as one Word, and values are Word sized.
+ *
+ * Units smaller than a byte are packed from the low bits of each byte.
+ * A partial last byte is padded with ones, which read as a truncated
+ * packet. vlu_codec<8, 8, uint64_t> is the VLU8 format of vlu_encode,
+ * and vlu_codec<8, 16, vlu_uint128> is the format of vlu_encode_112.
+ */
+template <unsigned BitsPerUnit, unsigned PrefixLimit, typename Word>
+struct vlu_codec
+{
+    typedef Word word_type;
+
+    static const unsigned bits_per_unit = BitsPerUnit;
+    static const unsigned prefix_limit = PrefixLimit;
+    static const unsigned word_bits = sizeof(Word) << 3;
+    static const unsigned interval_bits = PrefixLimit * (BitsPerUnit - 1);
+    static const unsigned max_offset = BitsPerUnit % 8 ? 8 - BitsPerUnit : 0;
+
+    static_assert(BitsPerUnit % 8 == 0 || (BitsPerUnit >= 2 && 8 % BitsPerUnit == 0),
+        "units must divide or be a multiple of a byte");
+    static_assert(PrefixLimit >= 2, "prefix limit must be at least 2");
+    static_assert(PrefixLimit * BitsPerUnit + max_offset <= word_bits,
+        "interval must fit in a word at any unit offset");
+    static_assert(Word(~Word(0)) > Word(0), "word must be unsigned");
+
+    struct result
+    {
+        Word val;
+        int64_t shamt;
+    };
+
+    /*
+     * encoded_units - packet size in units of the first interval
+     */
+    static unsigned encoded_units(Word num)
+    {
+        return num == 0 ? 1 : (word_bits - clz(num) + BitsPerUnit - 2) / (BitsPerUnit - 1);
+    }
+
+    /*
+     * encoded_size - size of a value in units over all intervals
+     */
+    static size_t encoded_size(Word num)
+    {
+        size_t n = 0;
+        while (encoded_units(num) > PrefixLimit) {
+            n += PrefixLimit;
+            num >>= interval_bits;
+        }
+        return n + encoded_units(num);
+    }
+
+    /*
+     * encode - encode one interval
+     *
+     * returns {
+     *   val:   encoded interval
+     *   shamt: packet size in units, or -1 for continuation
+     * }
+     */
+    static result encode(Word num)
+    {
+        unsigned len = encoded_units(num);
+        bool cont = len > PrefixLimit;
+        unsigned n = cont ? PrefixLimit : len;
+        Word val = cont ? Word(num & ((Word(1) << interval_bits) - 1)) : num;
+        Word enc = Word(val << n) | Word((Word(1) << (n - 1)) - 1)
+            | Word(Word(cont) << (PrefixLimit - 1));
+        return result{ enc, cont ? -1 : (int64_t)n };
+    }
+
+    /*
+     * decode - decode one interval
+     *
+     * returns {
+     *   val:   decoded bits
+     *   shamt: packet size in units, or -1 for continuation
+     * }
+     */
+    static result decode(Word x)
+    {
+        unsigned t = ctz(Word(~x | (Word(1) << PrefixLimit)));
+        bool cont = t >= PrefixLimit;
+        unsigned n = cont ? PrefixLimit : t + 1;
+        Word val = Word(x >> n) & Word((Word(1) << (n * (BitsPerUnit - 1))) - 1);
+        return result{ val, cont ? -1 : (int64_t)n };
+    }
+
+    /*
+     * load - word starting at unit u, zero filled past the end
+     */
+    static Word load(const uint8_t *src, size_t len, size_t u)
+    {
+        size_t b = u * BitsPerUnit, off = b >> 3;
+        Word x = 0;
+        if (off < len) std::memcpy(&x, src + off, std::min(sizeof(Word), len - off));
+        return Word(x >> (b & 7));
+    }
+
+    /*
+     * store - write an n unit packet at unit u
+     *
+     * A whole word is stored when it fits in the buffer, and the bits
+     * below the unit in its first byte are kept.
+     */
+    static void store(uint8_t *dst, size_t cap, size_t u, Word x, size_t n)
+    {
+        size_t b = u * BitsPerUnit, off = b >> 3, s = b & 7;
+        x = Word(x << s) | Word(s ? dst[off] & ((1u << s) - 1) : 0);
+        size_t bytes = (s + n * BitsPerUnit + 7) >> 3;
+        std::memcpy(dst + off, &x, cap - off >= sizeof(Word) ? sizeof(Word) : bytes);
+    }
+
+    /*
+     * decode_value - decode the intervals of one value at unit u
+     *
+     * Returns false, leaving u unchanged, if the value is cut short
+     * by the end of the buffer or does not fit in a word.
+     */
+    static bool decode_value(const uint8_t *src, size_t len, size_t &u, Word &val)
+    {
+        size_t units = (len << 3) / BitsPerUnit, v = u;
+        Word acc = 0;
+        for (unsigned sh = 0; sh < word_bits; sh += interval_bits) {
+            result r = decode(load(src, len, v));
+            size_t n = r.shamt < 0 ? PrefixLimit : (size_t)r.shamt;
+            if (v + n > units) return false;
+            if (sh && Word(r.val >> (word_bits - sh))) return false;
+            acc |= Word(r.val << sh);
+            v += n;
+            if (r.shamt > 0) {
+                val = acc;
+                u = v;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * size - packed size in bytes
+     */
+    static size_t size(const Word *src, size_t n)
+    {
+        size_t units = 0;
+        for (size_t i = 0; i < n; i++) {
+            units += encoded_size(src[i]);
+        }
+        return (units * BitsPerUnit + 7) >> 3;
+    }
+
+    /*
+     * items - number of values in buffer
+     */
+    static size_t items(const uint8_t *src, size_t len)
+    {
+        size_t units = (len << 3) / BitsPerUnit, u = 0, count = 0;
+        Word val;
+        while (u < units && decode_value(src, len, u, val)) count++;
+        return count;
+    }
+
+    /*
+     * encode - encode array into buffer
+     *
+     * returns {
+     *   nread:    number of values encoded
+     *   nwritten: number of bytes written
+     * }
+     */
+    static vlu_io_result encode(uint8_t *dst, size_t cap, const Word *src, size_t n)
+    {
+        size_t units = (cap << 3) / BitsPerUnit, u = 0, i = 0;
+        for (; i < n; i++) {
+            size_t v = u;
+            Word num = src[i];
+            bool done = false;
+            for (;;) {
+                result r = encode(num);
+                size_t k = r.shamt < 0 ? PrefixLimit : (size_t)r.shamt;
+                if (v + k > units) break;
+                store(dst, cap, v, r.val, k);
+                v += k;
+                if (r.shamt > 0) {
+                    done = true;
+                    break;
+                }
+                num >>= interval_bits;
+            }
+            if (!done) break;
+            u = v;
+        }
+
+        size_t bits = u * BitsPerUnit, bytes = (bits + 7) >> 3;
+        if (bits & 7) dst[bytes - 1] |= uint8_t(0xff << (bits & 7));
+        return vlu_io_result{ i, bytes };
+    }
+
+    /*
+     * decode - decode buffer into array
+     *
+     * returns {
+     *   nread:    number of bytes consumed
+     *   nwritten: number of values decoded
+     * }
+     */
+    static vlu_io_result decode(Word *dst, size_t cap, const uint8_t *src, size_t len)
+    {
+        size_t units = (len << 3) / BitsPerUnit, u = 0, o = 0;
+        while (o < cap && u < units && decode_value(src, len, u, dst[o])) o++;
+        return vlu_io_result{ (u * BitsPerUnit + 7) >> 3, o };
+    }
+
+    /*
+     * encode_vec - encode array
+     */
+    static void encode_vec(std::vector<uint8_t> &dst, std::vector<Word> &src)
+    {
+        size_t bytes = size(src.data(), src.size());
+        dst.resize(bytes + sizeof(Word));
+        vlu_io_result r = encode(dst.data(), dst.size(), src.data(), src.size());
+        assert(r.nread == src.size() && r.nwritten == bytes);
+        dst.resize(r.nwritten);
+    }
+
+    /*
+     * decode_vec - decode array
+     */
+    static void decode_vec(std::vector<Word> &dst, std::vector<uint8_t> &src)
+    {
+        size_t n = items(src.data(), src.size());
+        dst.resize(n);
+        vlu_io_result r = decode(dst.data(), n, src.data(), src.size());
+        assert(r.nwritten == n);
+        (void)r;
+    }
+};
+
+/*
+ * Common codecs
+ *
+ * vlu4_codec     - nibble units, 45 bits per interval, for small values
+ * vlu8_codec     - VLU8, 56 bits per interval, as vlu_encode
+ * vlu8_32_codec  - VLU8 on 32-bit words, 28 bits per interval
+ * vlu16_codec    - 16-bit units, 60 bits per interval
+ * vlu8_16_codec  - VLU8 with a 16-bit prefix limit, 112 bits per interval
+ */
+typedef vlu_codec<4, 15, uint64_t> vlu4_codec;
+typedef vlu_codec<8, 8, uint64_t> vlu8_codec;
+typedef vlu_codec<8, 4, uint32_t> vlu8_32_codec;
+typedef vlu_codec<16, 4, uint64_t> vlu16_codec;
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 vlu_uint128;
+typedef vlu_codec<8, 16, vlu_uint128> vlu8_16_codec;
+#endif
@@ -0,0 +1,627 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright (C) 2019, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "vlu.h"
+
+/*
+ * Parallel encoding
+ *
+ * The input is split into one chunk per thread and encoded in three
+ * phases: each thread sizes its chunk, an exclusive prefix sum of the
+ * sizes gives each chunk its output offset, then each thread encodes
+ * its chunk directly into the shared output. Chunks are given exact
+ * capacities so the word stores of one chunk never touch the next.
+ */
+
+/*
+ * vlu_parallel_min_chunk - smallest chunk when the thread count is automatic
+ */
+static const size_t vlu_parallel_min_chunk = 65536;
+
+/*
+ * vlu_parallel_threads - number of threads to use for n values or bytes
+ *
+ * Zero selects the hardware concurrency, limited so that each thread
+ * has at least vlu_parallel_min_chunk values or bytes.
+ */
+static size_t vlu_parallel_threads(size_t n, size_t nthreads)
+{
+    if (nthreads == 0) {
+        nthreads = std::thread::hardware_concurrency();
+        nthreads = std::min(nthreads, n / vlu_parallel_min_chunk);
+    }
+    return std::max((size_t)1, std::min(nthreads, n));
+}
+
+/*
+ * vlu_parallel_for - run fn(t) for t in [0, nthreads) on separate threads
+ *
+ * The first index runs on the calling thread.
+ */
+template <typename F>
+static void vlu_parallel_for(size_t nthreads, F fn)
+{
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < nthreads; t++) {
+        threads.emplace_back(fn, t);
+    }
+    fn(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * vlu_parallel_offsets - chunk output offsets from per thread sizes
+ *
+ * Returns nthreads + 1 offsets, the last being the total size.
+ */
+static std::vector<size_t> vlu_parallel_offsets(const uint64_t *src, size_t n, size_t nthreads)
+{
+    std::vector<size_t> off(nthreads + 1, 0);
+    vlu_parallel_for(nthreads, [&](size_t t) {
+        size_t i = n * t / nthreads, j = n * (t + 1) / nthreads;
+        off[t + 1] = vlu_size(src + i, j - i);
+    });
+    for (size_t t = 0; t < nthreads; t++) {
+        off[t + 1] += off[t];
+    }
+    return off;
+}
+
+/*
+ * vlu_parallel_write - encode each chunk at its offset
+ */
+static void vlu_parallel_write(uint8_t *dst, const uint64_t *src, size_t n,
+    size_t nthreads, const std::vector<size_t> &off)
+{
+    vlu_parallel_for(nthreads, [&](size_t t) {
+        size_t i = n * t / nthreads, j = n * (t + 1) / nthreads;
+        vlu_io_result r = vlu_encode(dst + off[t], off[t + 1] - off[t], src + i, j - i);
+        assert(r.nread == j - i && r.nwritten == off[t + 1] - off[t]);
+        (void)r;
+    });
+}
+
+/*
+ * vlu_encode_parallel - encode array into buffer using multiple threads
+ *
+ * nthreads of zero selects the thread count automatically.
+ *
+ * returns {
+ *   nread:    number of values, or zero if the buffer is too small
+ *   nwritten: number of bytes written
+ * }
+ */
+static vlu_io_result vlu_encode_parallel(uint8_t *dst, size_t cap, const uint64_t *src, size_t n,
+    size_t nthreads = 0)
+{
+    nthreads = vlu_parallel_threads(n, nthreads);
+    std::vector<size_t> off = vlu_parallel_offsets(src, n, nthreads);
+    if (off[nthreads] > cap) return vlu_io_result{ 0, 0 };
+    vlu_parallel_write(dst, src, n, nthreads, off);
+    return vlu_io_result{ n, off[nthreads] };
+}
+
+/*
+ * vlu_encode_vec_parallel - encode array using multiple threads
+ *
+ * The output is sized exactly from the first phase. Note that resizing
+ * the vector clears it on the calling thread; use vlu_encode_parallel
+ * with a preallocated buffer to avoid the extra pass.
+ */
+static void vlu_encode_vec_parallel(std::vector<uint8_t> &dst, std::vector<uint64_t> &src,
+    size_t nthreads = 0)
+{
+    size_t n = src.size();
+    nthreads = vlu_parallel_threads(n, nthreads);
+    std::vector<size_t> off = vlu_parallel_offsets(src.data(), n, nthreads);
+    dst.resize(off[nthreads]);
+    vlu_parallel_write(dst.data(), src.data(), n, nthreads, off);
+}
+
+/*
+ * Parallel decoding
+ *
+ * Packet boundaries are not known at a chunk boundary without a scan
+ * from the start of the stream, so each chunk is first scanned from
+ * its first byte as a guess of its entry position. The true entry is
+ * within the first 8 bytes, and two parses of a VLU8 stream usually
+ * meet after a few packets, so the boundaries in a window at the start
+ * of each chunk are recorded. A short serial pass then follows the
+ * true entry from each chunk to the next, walking from the true entry
+ * to a recorded boundary, or rescanning the chunk if the parses do
+ * not meet in the window. Each thread then decodes the values that
+ * start in its chunk into its own slice of the output. A value with a
+ * continuation interval that straddles a chunk boundary belongs to the
+ * chunk holding the interval.
+ */
+
+/*
+ * vlu_scan_result - packets starting in a range of the buffer
+ */
+struct vlu_scan_result
+{
+    size_t items; /* number of non-continuation packets */
+    size_t pos;   /* first packet boundary at or after the range */
+    bool cont;    /* last packet was a continuation interval */
+};
+
+/*
+ * vlu_scan - count packets starting from offset i up to end
+ *
+ * Packets may extend past end up to the buffer length l. cont is the
+ * state of the packet before i, returned if no packets start in range.
+ * The AVX2 version uses the pointer doubling counts from vlu_items,
+ * leaving at least one packet to the scalar loop so the last packet
+ * is known.
+ */
+static vlu_scan_result vlu_scan_scalar(const uint8_t *s, size_t l, size_t i, size_t end,
+    bool cont = false)
+{
+    size_t items = 0;
+    while (i < end && i < l) {
+        uint64_t d = 0;
+        std::memcpy(&d, s + i, std::min((size_t)8, l - i));
+        cont = (d & 0xff) == 0xff;
+        items += !cont;
+        i += vlu_decoded_size_56(d);
+    }
+    return vlu_scan_result{ items, i, cont };
+}
+
+#if USE_AVX2
+VLU_TARGET_AVX2
+static vlu_scan_result vlu_scan_avx2(const uint8_t *s, size_t l, size_t i, size_t end,
+    bool cont = false)
+{
+    alignas(32) uint8_t cnt[32], nxt[32];
+
+    size_t items = 0, b = i, q = 0;
+    for (; b + 48 <= end; b += 32) {
+        vlu_doubling_32(s + b, cnt, nxt);
+        items += cnt[q];
+        q = nxt[q] - 16;
+        items += cnt[q + 16];
+        q = nxt[q + 16] - 16;
+    }
+
+    vlu_scan_result r = vlu_scan_scalar(s, l, b + q, end, cont);
+    r.items += items;
+    return r;
+}
+#endif
+
+static vlu_scan_result vlu_scan(const uint8_t *s, size_t l, size_t i, size_t end,
+    bool cont = false)
+{
+#if USE_AVX2
+    if (vlu_cpu_avx2()) return vlu_scan_avx2(s, l, i, end, cont);
+#endif
+    return vlu_scan_scalar(s, l, i, end, cont);
+}
+
+/*
+ * vlu_parallel_chunk - speculative scan of one chunk
+ */
+struct vlu_parallel_chunk
+{
+    static const size_t window = 64;
+
+    size_t begin;
+    size_t end;
+    std::vector<size_t> pos;   /* packet boundaries in the window */
+    std::vector<size_t> items; /* packets before each boundary */
+    vlu_scan_result scan;      /* the whole chunk from begin */
+
+    void speculate(const uint8_t *s, size_t l)
+    {
+        size_t i = begin, n = 0;
+        bool cont = false;
+        while (i < end && i < l && i < begin + window) {
+            pos.push_back(i);
+            items.push_back(n);
+            uint64_t d = 0;
+            std::memcpy(&d, s + i, std::min((size_t)8, l - i));
+            cont = (d & 0xff) == 0xff;
+            n += !cont;
+            i += vlu_decoded_size_56(d);
+        }
+        scan = vlu_scan(s, l, i, end, cont);
+        scan.items += n;
+    }
+
+    /*
+     * resolve - packets starting in the chunk from the true entry
+     */
+    vlu_scan_result resolve(const uint8_t *s, size_t l, size_t entry) const
+    {
+        size_t i = entry, n = 0;
+        bool cont = false;
+        while (i < end && i < l && i < begin + window) {
+            auto p = std::lower_bound(pos.begin(), pos.end(), i);
+            if (p != pos.end() && *p == i) {
+                size_t j = p - pos.begin();
+                return vlu_scan_result{ n + scan.items - items[j], scan.pos, scan.cont };
+            }
+            uint64_t d = 0;
+            std::memcpy(&d, s + i, std::min((size_t)8, l - i));
+            cont = (d & 0xff) == 0xff;
+            n += !cont;
+            i += vlu_decoded_size_56(d);
+        }
+        vlu_scan_result r = vlu_scan(s, l, i, end, cont);
+        r.items += n;
+        return r;
+    }
+};
+
+/*
+ * vlu_parallel_plan - output slice for each chunk
+ */
+struct vlu_parallel_plan
+{
+    std::vector<size_t> src; /* first byte of the first value of the chunk */
+    std::vector<size_t> dst; /* output offset, nthreads + 1 entries */
+};
+
+/*
+ * vlu_parallel_plan_decode - find the values starting in each chunk
+ */
+static vlu_parallel_plan vlu_parallel_plan_decode(const uint8_t *s, size_t l, size_t nthreads)
+{
+    std::vector<vlu_parallel_chunk> chunks(nthreads);
+    vlu_parallel_for(nthreads, [&](size_t t) {
+        chunks[t].begin = l * t / nthreads;
+        chunks[t].end = l * (t + 1) / nthreads;
+        chunks[t].speculate(s, l);
+    });
+
+    vlu_parallel_plan plan;
+    plan.src.resize(nthreads);
+    plan.dst.resize(nthreads + 1);
+    plan.dst[0] = 0;
+
+    size_t entry = 0, count = 0;
+    bool cont = false;
+    for (size_t t = 0; t < nthreads; t++) {
+        vlu_parallel_chunk &c = chunks[t];
+        plan.src[t] = entry;
+        if (entry >= c.end || entry >= l) {
+            /* a packet from an earlier chunk covers this chunk */
+            plan.dst[t + 1] = count;
+            continue;
+        }
+        vlu_scan_result r = entry == c.begin ? c.scan : c.resolve(s, l, entry);
+        size_t n = r.items;
+        if (cont) {
+            /* the terminal at the entry belongs to the previous chunk */
+            uint64_t d = 0;
+            std::memcpy(&d, s + entry, std::min((size_t)8, l - entry));
+            plan.src[t] += vlu_decoded_size_56(d);
+            n--;
+        }
+        n += r.cont;
+        count += n;
+        plan.dst[t + 1] = count;
+        entry = r.pos;
+        cont = r.cont;
+    }
+
+    return plan;
+}
+
+/*
+ * vlu_parallel_read - decode each chunk into its output slice
+ */
+static void vlu_parallel_read(uint64_t *dst, const uint8_t *src, size_t len,
+    size_t nthreads, const vlu_parallel_plan &plan)
+{
+    vlu_parallel_for(nthreads, [&](size_t t) {
+        size_t i = std::min(plan.src[t], len), n = plan.dst[t + 1] - plan.dst[t];
+        vlu_io_result r = vlu_decode_simd(dst + plan.dst[t], n, src + i, len - i);
+        assert(r.nwritten == n);
+        (void)r;
+    });
+}
+
+/*
+ * vlu_decode_parallel - decode buffer into array using multiple threads
+ *
+ * nthreads of zero selects the thread count automatically.
+ *
+ * returns {
+ *   nread:    number of bytes read, or zero if the array is too small
+ *   nwritten: number of values written
+ * }
+ */
+static vlu_io_result vlu_decode_parallel(uint64_t *dst, size_t cap, const uint8_t *src, size_t len,
+    size_t nthreads = 0)
+{
+    nthreads = vlu_parallel_threads(len, nthreads);
+    vlu_parallel_plan plan = vlu_parallel_plan_decode(src, len, nthreads);
+    if (plan.dst[nthreads] > cap) return vlu_io_result{ 0, 0 };
+    vlu_parallel_read(dst, src, len, nthreads, plan);
+    return vlu_io_result{ len, plan.dst[nthreads] };
+}
+
+/*
+ * vlu_decode_vec_parallel - decode array using multiple threads
+ *
+ * The item count comes from the planning phase, which replaces the
+ * vlu_items pass of vlu_decode_vec.
+ */
+static void vlu_decode_vec_parallel(std::vector<uint64_t> &dst, std::vector<uint8_t> &src,
+    size_t nthreads = 0)
+{
+    size_t len = src.size();
+    nthreads = vlu_parallel_threads(len, nthreads);
+    vlu_parallel_plan plan = vlu_parallel_plan_decode(src.data(), len, nthreads);
+    dst.resize(plan.dst[nthreads]);
+    vlu_parallel_read(dst.data(), src.data(), len, nthreads, plan);
+}
+
+/*
+ * Batch scheduling
+ *
+ * Many small arrays are coded as a batch of jobs on a work-stealing
+ * pool. Consecutive jobs are grouped until a group holds at least
+ * vlu_batch_grain values or bytes, so that scheduling costs one atomic
+ * operation per group rather than per job. Each thread starts with an
+ * equal range of groups and pops from the front of its own range. A
+ * thread that runs out steals the back half of another thread's range.
+ * Ranges are packed into one atomic word so that pops and steals are a
+ * single compare and swap. Grouping only amortizes scheduling: each job
+ * still sizes its output with a vlu_size or vlu_items pass and resizes
+ * its own vector once to the exact size, which reuses its capacity when
+ * vectors are recycled.
+ */
+
+/*
+ * vlu_batch_grain - smallest group of jobs in values or bytes
+ */
+static const size_t vlu_batch_grain = 4096;
+
+/*
+ * vlu_batch_encode_job - encode src[0..n) into dst
+ */
+struct vlu_batch_encode_job
+{
+    const uint64_t *src;
+    size_t n;
+    std::vector<uint8_t> *dst;
+};
+
+/*
+ * vlu_batch_decode_job - decode src[0..len) into dst
+ */
+struct vlu_batch_decode_job
+{
+    const uint8_t *src;
+    size_t len;
+    std::vector<uint64_t> *dst;
+};
+
+/*
+ * vlu_batch_stats - aggregate statistics for a batch
+ */
+struct vlu_batch_stats
+{
+    size_t jobs;
+    size_t values;
+    size_t bytes;
+    size_t threads;
+    size_t steals;
+    double seconds;
+
+    /*
+     * values_per_second - value throughput
+     */
+    double values_per_second() const { return seconds > 0 ? values / seconds : 0; }
+
+    /*
+     * bytes_per_second - packed byte throughput
+     */
+    double bytes_per_second() const { return seconds > 0 ? bytes / seconds : 0; }
+};
+
+/*
+ * vlu_batch_queue - range of groups owned by one thread
+ */
+struct alignas(64) vlu_batch_queue
+{
+    std::atomic<uint64_t> range; /* begin << 32 | end */
+
+    static uint64_t pack(size_t b, size_t e) { return (uint64_t)b << 32 | e; }
+
+    /*
+     * pop - take the first group
+     */
+    bool pop(size_t &g)
+    {
+        uint64_t v = range.load();
+        for (;;) {
+            size_t b = v >> 32, e = (uint32_t)v;
+            if (b >= e) return false;
+            if (range.compare_exchange_weak(v, pack(b + 1, e))) {
+                g = b;
+                return true;
+            }
+        }
+    }
+
+    /*
+     * steal - take the back half, returning its first group
+     */
+    bool steal(size_t &g, size_t &e)
+    {
+        uint64_t v = range.load();
+        for (;;) {
+            size_t b = v >> 32;
+            e = (uint32_t)v;
+            if (b >= e) return false;
+            size_t m = b + (e - b) / 2;
+            if (range.compare_exchange_weak(v, pack(b, m))) {
+                g = m;
+                return true;
+            }
+        }
+    }
+};
+
+/*
+ * vlu_batch_run - run fn(job, stats) for every job on a work-stealing pool
+ *
+ * group holds the first job of each group and the job count.
+ */
+template <typename F>
+static vlu_batch_stats vlu_batch_run(const std::vector<size_t> &group, size_t nthreads, F fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t ngroups = group.size() - 1;
+    std::vector<vlu_batch_queue> queue(nthreads);
+    std::vector<vlu_batch_stats> stats(nthreads, vlu_batch_stats{});
+    for (size_t t = 0; t < nthreads; t++) {
+        queue[t].range.store(vlu_batch_queue::pack(ngroups * t / nthreads,
+            ngroups * (t + 1) / nthreads));
+    }
+
+    vlu_parallel_for(nthreads, [&](size_t t) {
+        /* counted locally so workers do not share cache lines */
+        vlu_batch_stats s = vlu_batch_stats{};
+        for (;;) {
+            size_t g = 0, e = 0;
+            if (!queue[t].pop(g)) {
+                size_t v = 1;
+                for (; v < nthreads; v++) {
+                    if (queue[(t + v) % nthreads].steal(g, e)) break;
+                }
+                if (v == nthreads) break;
+                /* only thieves write a non-empty queue, so a store suffices */
+                queue[t].range.store(vlu_batch_queue::pack(g + 1, e));
+                s.steals++;
+            }
+            for (size_t j = group[g]; j < group[g + 1]; j++) {
+                fn(j, s);
+            }
+            s.jobs += group[g + 1] - group[g];
+        }
+        stats[t] = s;
+    });
+
+    vlu_batch_stats total = vlu_batch_stats{};
+    for (auto &s : stats) {
+        total.jobs += s.jobs;
+        total.values += s.values;
+        total.bytes += s.bytes;
+        total.steals += s.steals;
+    }
+    total.threads = nthreads;
+    total.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return total;
+}
+
+/*
+ * vlu_batch_groups - group consecutive jobs of at least grain units
+ */
+template <typename J, typename S>
+static std::vector<size_t> vlu_batch_groups(const std::vector<J> &jobs, S size, size_t &total)
+{
+    std::vector<size_t> group(1, 0);
+    size_t acc = 0;
+    total = 0;
+    for (size_t j = 0; j < jobs.size(); j++) {
+        acc += size(jobs[j]) + 1;
+        total += size(jobs[j]);
+        if (acc >= vlu_batch_grain) {
+            group.push_back(j + 1);
+            acc = 0;
+        }
+    }
+    if (group.back() != jobs.size()) group.push_back(jobs.size());
+    return group;
+}
+
+/*
+ * vlu_encode_batch - encode a batch of arrays using a work-stealing pool
+ *
+ * nthreads of zero selects the thread count automatically.
+ */
+static vlu_batch_stats vlu_encode_batch(const std::vector<vlu_batch_encode_job> &jobs,
+    size_t nthreads = 0)
+{
+    size_t total;
+    std::vector<size_t> group = vlu_batch_groups(jobs,
+        [](const vlu_batch_encode_job &j) { return j.n; }, total);
+    nthreads = std::min(vlu_parallel_threads(total, nthreads), group.size() - 1);
+    nthreads = std::max((size_t)1, nthreads);
+    return vlu_batch_run(group, nthreads, [&](size_t j, vlu_batch_stats &s) {
+        const vlu_batch_encode_job &job = jobs[j];
+        size_t len = vlu_size(job.src, job.n);
+        job.dst->resize(len);
+        vlu_io_result r = vlu_encode(job.dst->data(), len, job.src, job.n);
+        assert(r.nread == job.n && r.nwritten == len);
+        (void)r;
+        s.values += job.n;
+        s.bytes += len;
+    });
+}
+
+/*
+ * vlu_decode_batch - decode a batch of arrays using a work-stealing pool
+ *
+ * nthreads of zero selects the thread count automatically.
+ */
+static vlu_batch_stats vlu_decode_batch(const std::vector<vlu_batch_decode_job> &jobs,
+    size_t nthreads = 0)
+{
+    size_t total;
+    std::vector<size_t> group = vlu_batch_groups(jobs,
+        [](const vlu_batch_decode_job &j) { return j.len; }, total);
+    nthreads = std::min(vlu_parallel_threads(total, nthreads), group.size() - 1);
+    nthreads = std::max((size_t)1, nthreads);
+    return vlu_batch_run(group, nthreads, [&](size_t j, vlu_batch_stats &s) {
+        const vlu_batch_decode_job &job = jobs[j];
+        size_t items = vlu_items(job.src, job.len);
+        job.dst->resize(items);
+        vlu_io_result r = vlu_decode_simd(job.dst->data(), items, job.src, job.len);
+        assert(r.nwritten == items);
+        (void)r;
+        s.values += items;
+        s.bytes += job.len;
+    });
+}
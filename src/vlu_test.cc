@@ -35,6 +35,8 @@
 #include <string>
 
 #include "vlu.h"
+#include "vlu_parallel.h"
+#include "vlu_codec.h"
 
 /*
  * random numbers
@@ -75,6 +77,67 @@ struct bench_random
  * simple tests
  */
 
+static_assert(const_clz<uint64_t>(1) == 63, "const_clz");
+static_assert(const_clz<uint8_t>(0) == 8, "const_clz");
+static_assert(const_ctz<uint32_t>(0x80000000u) == 31, "const_ctz");
+static_assert(const_ctz<uint16_t>(0) == 16, "const_ctz");
+static_assert(const_popcount<uint64_t>(0xff00ff00ff00ff00ull) == 32, "const_popcount");
+static_assert(const_pext<uint32_t>(0xf0f0, 0xff00) == 0xf0, "const_pext");
+static_assert(const_pdep<uint32_t>(0xf, 0xf0f0) == 0xf0, "const_pdep");
+
+template <typename T>
+void test_bits_type(bench_random &random)
+{
+    const int bits = sizeof(T) << 3;
+
+    for (size_t i = 0; i < 4000; i++) {
+        T v = T((random.pure_56() << 8 | random.pure_8()) >> (i % bits));
+        T m = T(random.pure_56() << 8 | random.pure_8());
+        if (i % 5 == 0) v = T(v & m);
+
+        int lz = 0, tz = 0, pc = 0;
+        while (lz < bits && !((v >> (bits - 1 - lz)) & 1)) lz++;
+        while (tz < bits && !((v >> tz) & 1)) tz++;
+        for (int b = 0; b < bits; b++) pc += (v >> b) & 1;
+        T ext = 0, dep = 0;
+        for (int b = 0, k = 0; b < bits; b++) {
+            if ((m >> b) & 1) {
+                ext = T(ext | T(((v >> b) & 1) << k));
+                dep = T(dep | T(((v >> k) & 1) << b));
+                k++;
+            }
+        }
+
+        /* the 32-bit and 64-bit builtins are undefined for zero */
+        if (v != 0 || sizeof(T) < 4) {
+            assert(clz(v) == lz);
+            assert(ctz(v) == tz);
+        }
+        assert(const_clz(v) == lz);
+        assert(const_ctz(v) == tz);
+        assert(popcount(v) == pc && const_popcount(v) == pc);
+        assert(pext(v, m) == ext && const_pext(v, m) == ext);
+        assert(pdep(v, m) == dep && const_pdep(v, m) == dep);
+    }
+}
+
+void test_bits()
+{
+    bench_random random;
+
+    test_bits_type<uint8_t>(random);
+    test_bits_type<uint16_t>(random);
+    test_bits_type<uint32_t>(random);
+    test_bits_type<uint64_t>(random);
+    /* distinct types without specializations use the generic versions */
+    test_bits_type<char16_t>(random);
+    test_bits_type<char32_t>(random);
+    assert(clz(char16_t(0)) == 16 && ctz(char32_t(0)) == 32);
+    /* signed types are not sign extended */
+    assert(popcount<int>(-1) == 32 && popcount<signed char>(-1) == 8);
+    assert(popcount<short>(-2) == 15 && popcount<long long>(-1) == 64);
+}
+
 void test_encode_uvlu()
 {
     bench_random random;
@@ -122,6 +185,8 @@ void test_encode_uvlu()
     assert(vlu_decode_56(0xffffffffffffff7f).shamt == 8);
     assert(vlu_decode_56(0xffffffffffffffff).val == 0x00ffffffffffffff);
     assert(vlu_decode_56(0xffffffffffffffff).shamt == -1); /* continuation */
+    assert(vlu_decode_56(0x123456789abcdeff).val == 0x123456789abcde);
+    assert(vlu_decode_56(0x123456789abcdeff).shamt == -1); /* continuation */
 
     /* mask test */
     assert(vlu_decode_56(0xff80 | vlu_encode_56(0x7d).val).val == 0x7d);
@@ -196,6 +261,987 @@ void test_roundtrip_uvlu_u21()
     }
 }
 
+void test_items_uvlu()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint64_t> d1(n < 100 ? n : n * 37);
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = (n & 1) ? random.mix_56() : random.pure_56();
+        }
+        vlu_encode_vec(d2, d1);
+        assert(vlu_items_vec(d2) == d1.size());
+    }
+}
+
+void test_buffer_uvlu()
+{
+    bench_random random;
+
+    std::vector<uint64_t> d1(1000), d3(1000);
+    std::vector<uint8_t> d2(vlu_encode_bound(d1.size()));
+    for (size_t i = 0; i < d1.size(); i++) {
+        d1[i] = random.mix_56();
+    }
+    size_t len = vlu_size(d1.data(), d1.size());
+
+    /* encode stops at the last packet that fits */
+    for (size_t cap = 0; cap < len + 16; cap += 7) {
+        vlu_io_result r = vlu_encode(d2.data(), cap, d1.data(), d1.size());
+        assert(r.nwritten <= cap);
+        assert(r.nwritten == vlu_size(d1.data(), r.nread));
+        assert(r.nread == d1.size() || r.nwritten + vlu_encoded_size_56(d1[r.nread]) > cap);
+    }
+
+    /* decode stops at a full array or a truncated packet */
+    vlu_io_result e = vlu_encode(d2.data(), d2.size(), d1.data(), d1.size());
+    assert(e.nread == d1.size() && e.nwritten == len);
+    for (size_t cap = 0; cap <= d1.size(); cap += 37) {
+        vlu_io_result r = vlu_decode(d3.data(), cap, d2.data(), len);
+        assert(r.nwritten == cap);
+        assert(r.nread == vlu_size(d1.data(), cap));
+        for (size_t i = 0; i < cap; i++) assert(d3[i] == d1[i]);
+    }
+    for (size_t l = 0; l <= len; l += 13) {
+        vlu_io_result r = vlu_decode(d3.data(), d3.size(), d2.data(), l);
+        assert(r.nread <= l);
+        assert(r.nread == vlu_size(d1.data(), r.nwritten));
+        assert(r.nwritten == d1.size() || r.nread + vlu_encoded_size_56(d1[r.nwritten]) > l);
+#if USE_AVX2
+        if (vlu_cpu_avx2()) {
+            vlu_io_result r2 = vlu_decode_avx2(d3.data(), d3.size(), d2.data(), l);
+            assert(r2.nread == r.nread && r2.nwritten == r.nwritten);
+        }
+#endif
+#if USE_AVX512_VBMI2
+        if (vlu_cpu_avx512vbmi2()) {
+            vlu_io_result r3 = vlu_decode_avx512(d3.data(), d3.size(), d2.data(), l);
+            assert(r3.nread == r.nread && r3.nwritten == r.nwritten);
+        }
+#endif
+        for (size_t i = 0; i < r.nwritten; i++) assert(d3[i] == d1[i]);
+    }
+}
+
+void test_checked_uvlu()
+{
+    bench_random random;
+
+    std::vector<uint64_t> d1(1000), d3(1000);
+    std::vector<uint8_t> d2;
+    for (size_t i = 0; i < d1.size(); i++) {
+        d1[i] = i % 5 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+    }
+    vlu_encode_vec(d2, d1);
+
+    /* a cut stream reports truncation at the start of the cut packet */
+    for (size_t l = 0; l <= d2.size(); l++) {
+        std::vector<uint8_t> d4(d2.begin(), d2.begin() + l);
+        vlu_checked_result r = vlu_decode_checked(d3.data(), d3.size(), d4.data(), l);
+        vlu_io_result e = vlu_decode(d3.data(), d3.size(), d4.data(), l);
+        assert(r.nread == e.nread && r.nwritten == e.nwritten);
+        assert(r.status == (r.nread == l ? vlu_ok : vlu_truncated));
+        for (size_t i = 0; i < r.nwritten; i++) assert(d3[i] == d1[i]);
+    }
+
+    std::vector<uint64_t> d5;
+    vlu_checked_result r = vlu_decode_vec_checked(d5, d2);
+    assert(r.status == vlu_ok && r.nread == d2.size() && d5 == d1);
+
+    /* values over 64 bits are rejected in the fast loop and the tail */
+    const uint8_t bad[][2] = { { 0x03, 0x00 }, { 0x01, 0x04 }, { 0x07, 0xff } };
+    for (size_t k = 0; k < 3; k++) {
+        for (size_t pad = 0; pad < 20; pad += 19) {
+            std::vector<uint8_t> d6(d2.begin(), d2.begin() + vlu_size(d1.data(), 10));
+            d6.insert(d6.end(), 8, 0xff);
+            d6.insert(d6.end(), bad[k], bad[k] + 2);
+            d6.insert(d6.end(), pad, 0);
+            d5.clear();
+            r = vlu_decode_vec_checked(d5, d6);
+            assert(r.status == vlu_overflow && r.nwritten == 10);
+            assert(r.nread == vlu_size(d1.data(), 10));
+            assert(std::equal(d5.begin(), d5.end(), d1.begin()));
+        }
+    }
+
+    /* a 2-byte terminal with 8 bits is the largest valid value */
+    const uint8_t max[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd, 0x03 };
+    uint64_t v;
+    r = vlu_decode_checked(&v, 1, max, sizeof(max));
+    assert(r.status == vlu_ok && r.nread == 10 && v == ~0ull);
+
+    /* signed values */
+    std::vector<int64_t> s1(1000), s3(1000);
+    for (size_t i = 0; i < s1.size(); i++) s1[i] = (int64_t)random.mix_56() - (1ll << 40);
+    svlu_encode_vec(d2, s1);
+    r = svlu_decode_checked(s3.data(), s3.size(), d2.data(), d2.size());
+    assert(r.status == vlu_ok && r.nwritten == s1.size() && s3 == s1);
+
+    /* random bytes never read outside the buffer */
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint8_t> d7(n);
+        for (size_t i = 0; i < n; i++) d7[i] = random.pure_8() | (i % 3 ? 0 : 0xff);
+        r = vlu_decode_vec_checked(d5, d7);
+        assert(r.nread <= n && r.nwritten == d5.size());
+        assert((r.status == vlu_ok) == (r.nread == n));
+    }
+}
+
+void test_stream_uvlu()
+{
+    bench_random random;
+    std::mt19937 chunks(1);
+
+    std::vector<uint64_t> d1(10000), d3(d1.size());
+    std::vector<uint8_t> d2;
+    for (size_t i = 0; i < d1.size(); i++) {
+        d1[i] = random.mix_56();
+    }
+    vlu_encode_vec(d2, d1);
+
+    for (size_t max = 1; max < 300; max = max * 3 + 1) {
+        vlu_stream_decoder dec;
+        size_t i = 0, o = 0;
+        while (i < d2.size()) {
+            size_t len = std::min(d2.size() - i, (size_t)chunks() % max + 1);
+            size_t cap = std::min(d1.size() - o, (size_t)chunks() % max + 1);
+            vlu_io_result r = dec.decode(d3.data() + o, cap, d2.data() + i, len);
+            assert(r.nread <= len && r.nwritten <= cap);
+            i += r.nread;
+            o += r.nwritten;
+        }
+        assert(dec.pending() == 0);
+        assert(o == d1.size());
+        for (size_t j = 0; j < o; j++) assert(d3[j] == d1[j]);
+    }
+
+    /* a truncated stream leaves a partial packet pending */
+    vlu_stream_decoder dec;
+    uint64_t v;
+    uint8_t b[8] = { 0x7f, 1, 2, 3, 4, 5, 6, 7 };
+    vlu_io_result r = dec.decode(&v, 1, b, 5);
+    assert(r.nread == 5 && r.nwritten == 0 && dec.pending() == 5);
+    r = dec.decode(&v, 1, b + 5, 3);
+    assert(r.nread == 3 && r.nwritten == 1 && dec.pending() == 0);
+    assert(v == 0x07060504030201ull);
+}
+
+void test_stream_encode_uvlu()
+{
+    bench_random random;
+
+    std::vector<uint64_t> d1(10000);
+    std::vector<uint8_t> d2;
+    for (size_t i = 0; i < d1.size(); i++) {
+        d1[i] = random.mix_56();
+    }
+    vlu_encode_vec(d2, d1);
+
+    for (size_t bs : { 1, 3, 8, 61, 4096, 65536 }) {
+        std::vector<uint8_t> d3;
+        size_t partial = 0;
+        vlu_stream_encoder enc([&](const uint8_t *data, size_t len) {
+            assert(partial == 0);
+            if (len < bs) partial++;
+            d3.insert(d3.end(), data, data + len);
+        }, bs);
+        size_t half = d1.size() / 2;
+        for (size_t i = 0; i < half; i++) enc.put(d1[i]);
+        enc.put(d1.data() + half, d1.size() - half);
+        enc.flush();
+        assert(d3 == d2);
+    }
+}
+
+#if USE_AVX2
+void test_roundtrip_uvlu_avx2()
+{
+    bench_random random;
+
+    if (!vlu_cpu_avx2()) return;
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint64_t> d1(n < 100 ? n : n * 37);
+        std::vector<uint8_t> d2;
+        std::vector<uint64_t> d3;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = (n & 1) ? random.mix_56() : random.pure_8();
+        }
+        vlu_encode_vec(d2, d1);
+        vlu_decode_vec_avx2(d3, d2);
+        assert(d1.size() == d3.size());
+        for (size_t i = 0; i < d1.size(); i++) {
+            assert(d1[i] == d3[i]);
+        }
+    }
+}
+#endif
+
+#if USE_AVX512_VBMI2
+void test_roundtrip_uvlu_avx512()
+{
+    bench_random random;
+
+    if (!vlu_cpu_avx512vbmi2()) return;
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint64_t> d1(n < 100 ? n : n * 37);
+        std::vector<uint8_t> d2, d4;
+        std::vector<uint64_t> d3;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = (n & 1) ? random.mix_56() : random.pure_8();
+        }
+        vlu_encode_vec(d2, d1);
+        vlu_encode_vec_avx512(d4, d1);
+        assert(d2 == d4);
+        assert(vlu_items_avx512(d2.data(), d2.size()) == d1.size());
+        vlu_decode_vec_avx512(d3, d2);
+        assert(d1.size() == d3.size());
+        for (size_t i = 0; i < d1.size(); i++) {
+            assert(d1[i] == d3[i]);
+        }
+    }
+}
+#endif
+
+void test_encode_uvlu_112()
+{
+    bench_random random;
+
+    assert(vlu_encoded_size_112(0, 0) == 1);
+    assert(vlu_encoded_size_112(0x7f, 0) == 1);
+    assert(vlu_encoded_size_112(0x00ffffffffffffff, 0) == 8);
+    assert(vlu_encoded_size_112(0x0100000000000000, 0) == 9);
+    assert(vlu_encoded_size_112(0xffffffffffffffff, 0) == 10);
+    assert(vlu_encoded_size_112(0xffffffffffffffff, 0x0000ffffffffffff) == 16);
+
+    assert(vlu_decoded_size_112(0x7f) == 8);
+    assert(vlu_decoded_size_112(0x00ff) == 9);
+    assert(vlu_decoded_size_112(0x7fff) == 16);
+    assert(vlu_decoded_size_112(0xffff) == 16);
+
+    vlu_result_112 e = vlu_encode_112(0xffffffffffffffff, 0x0000ffffffffffff);
+    assert(e.lo == 0xffffffffffff7fff && e.hi == 0xffffffffffffffff && e.shamt == 16);
+    e = vlu_encode_112(0, 0x0001000000000000);
+    assert(e.lo == 0xffff && e.shamt == -1); /* continuation */
+    vlu_result_112 d = vlu_decode_112(0xffffffffffffffff, 0xffffffffffffffff);
+    assert(d.lo == 0xffffffffffffffff && d.hi == 0x0000ffffffffffff && d.shamt == -1);
+
+    /* packets of up to 8 bytes match the 56-bit encoding */
+    for (size_t i = 0; i < 100; i++) {
+        uint64_t val = random.mix_56();
+        e = vlu_encode_112(val, 0);
+        assert(e.lo == vlu_encode_56(val).val && e.hi == 0);
+        assert(e.shamt == vlu_encode_56(val).shamt);
+    }
+
+    for (size_t i = 0; i < 1000; i++) {
+        uint64_t lo = random.pure_56() << 8 | random.pure_8();
+        uint64_t hi = random.mix_56() >> 8;
+        if (i & 8) { lo >>= hi & 63; hi = 0; }
+        e = vlu_encode_112(lo, hi);
+        assert(e.shamt == vlu_encoded_size_112(lo, hi));
+        assert(e.shamt == vlu_decoded_size_112(e.lo));
+        d = vlu_decode_112(e.lo, e.hi);
+        assert(d.lo == lo && d.hi == hi && d.shamt == e.shamt);
+    }
+}
+
+void test_roundtrip_uvlu_112()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<vlu_u128> d1(n < 100 ? n : n * 37), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i].lo = random.pure_56() << 8 | random.pure_8();
+            d1[i].hi = random.mix_56() >> 8;
+            if (n & 1) { d1[i].lo >>= d1[i].hi & 63; d1[i].hi = 0; }
+            if (n % 3 == 2 && i % 2) d1[i].hi |= (random.pure_56() & 0xffff) << 48;
+        }
+        vlu_encode_vec_112(d2, d1);
+        assert(d2.size() == vlu_size_112(d1.data(), d1.size()));
+        assert(vlu_items_112(d2.data(), d2.size()) == d1.size());
+        vlu_decode_vec_112(d3, d2);
+        assert(d1.size() == d3.size());
+        for (size_t i = 0; i < d1.size(); i++) {
+            assert(d1[i].lo == d3[i].lo && d1[i].hi == d3[i].hi);
+        }
+    }
+
+    /* values above 112 bits take a continuation interval and a terminal */
+    std::vector<vlu_u128> d1 = { { 1, 0 }, { 2, 1ull << 50 }, { 3, 0 }, { ~0ull, ~0ull } }, d3;
+    std::vector<uint8_t> d2;
+    vlu_encode_vec_112(d2, d1);
+    assert(d2.size() == 1 + 17 + 1 + 19);
+    assert(d2[1] == 0xff && d2[2] == 0xff && d2[17] == 0x08);
+    vlu_decode_vec_112(d3, d2);
+    assert(d3.size() == d1.size());
+    for (size_t i = 0; i < d1.size(); i++) {
+        assert(d1[i].lo == d3[i].lo && d1[i].hi == d3[i].hi);
+    }
+
+    /* short buffers and cut streams stop before the wide packet */
+    for (size_t l = 0; l <= d2.size(); l++) {
+        std::vector<uint8_t> d4(l);
+        vlu_io_result r = vlu_encode_buf_112(d4.data(), l, d1.data(), d1.size());
+        assert(r.nwritten == vlu_size_112(d1.data(), r.nread));
+        assert(r.nread == d1.size() || r.nwritten + vlu_size_112(&d1[r.nread], 1) > l);
+        std::vector<uint8_t> d5(d2.begin(), d2.begin() + l);
+        std::vector<vlu_u128> d6(d1.size());
+        r = vlu_decode_buf_112(d6.data(), d6.size(), d5.data(), l);
+        assert(r.nread == vlu_size_112(d1.data(), r.nwritten));
+        assert(r.nwritten == d1.size() || r.nread + vlu_size_112(&d1[r.nwritten], 1) > l);
+    }
+}
+
+void test_roundtrip_uvlu_big()
+{
+    bench_random random;
+
+    /* 2^56 is one interval holding zero and a terminal 1 */
+    std::vector<uint64_t> d1 = { 1ull << 56 }, d3;
+    std::vector<uint8_t> d2, d4;
+    vlu_encode_vec_big(d2, d1);
+    assert(d2 == std::vector<uint8_t>({ 0xff, 0, 0, 0, 0, 0, 0, 0, 0b10 }));
+    vlu_decode_vec_big(d3, d2);
+    assert(d3 == d1);
+
+    /* zero encodes as a single byte and decodes to no limbs */
+    d1 = { 0, 0 };
+    vlu_encode_vec_big(d2, d1);
+    assert(d2 == std::vector<uint8_t>({ 0 }));
+    vlu_decode_vec_big(d3, d2);
+    assert(d3.size() == 0);
+
+    for (size_t n = 1; n <= 64; n++) {
+        for (size_t j = 0; j < 8; j++) {
+            d1.resize(n);
+            for (size_t i = 0; i < n; i++) {
+                d1[i] = random.pure_56() << 8 | random.pure_8();
+            }
+            d1[n - 1] >>= j * 8 + (d1[0] & 7);
+            if (d1[n - 1] == 0) d1[n - 1] = 1;
+            vlu_encode_vec_big(d2, d1);
+            assert(d2.size() == vlu_encoded_size_big(d1.data(), n));
+            vlu_status st = vlu_decode_vec_big(d3, d2);
+            assert(st == vlu_ok && d3 == d1);
+
+            /* too small buffers and truncated input fail */
+            vlu_io_result r = vlu_encode_big(d2.data(), d2.size() - 1, d1.data(), n);
+            assert(r.nread == 0 && r.nwritten == 0);
+            r = vlu_decode_big(d3.data(), n, d2.data(), d2.size() - 1);
+            assert(r.nread == 0);
+            d4.assign(d2.begin(), d2.end() - 1);
+            st = vlu_decode_vec_big(d3, d4);
+            assert(st == vlu_truncated && d3.size() == 0);
+            d3.resize(n);
+            r = vlu_decode_big(d3.data(), n, d2.data(), d2.size());
+            assert(r.nread == d2.size() && r.nwritten == n);
+            if (n > 1) {
+                r = vlu_decode_big(d3.data(), n - 1, d2.data(), d2.size());
+                assert(r.nread == 0);
+            }
+        }
+    }
+}
+
+void test_roundtrip_uvlu_64()
+{
+    bench_random random;
+
+    assert(vlu_encoded_size_64(0x00ffffffffffffff) == 8);
+    assert(vlu_encoded_size_64(0x0100000000000000) == 9);
+    assert(vlu_encoded_size_64(0xffffffffffffffff) == 10);
+
+    vlu_result_112 e = vlu_encode_64(0xffffffffffffffff);
+    assert(e.lo == 0xffffffffffffffff && e.hi == 0b1111111101 && e.shamt == 10);
+    vlu_result d = vlu_decode_64(e.lo, e.hi);
+    assert(d.val == 0xffffffffffffffff && d.shamt == 10);
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint64_t> d1(n < 100 ? n : n * 37), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            uint64_t full = random.pure_56() << 8 | random.pure_8();
+            d1[i] = (i % (n % 4 + 1)) == 0 ? full : random.mix_56();
+        }
+        vlu_encode_vec(d2, d1);
+        assert(d2.size() == vlu_size(d1.data(), d1.size()));
+        assert(vlu_items_vec(d2) == d1.size());
+        vlu_decode_vec(d3, d2);
+        assert(d3 == d1);
+#if USE_AVX2
+        if (vlu_cpu_avx2()) {
+            vlu_decode_vec_avx2(d3, d2);
+            assert(d3 == d1);
+        }
+#endif
+#if USE_AVX512_VBMI2
+        if (vlu_cpu_avx512vbmi2()) {
+            std::vector<uint8_t> d4;
+            vlu_encode_vec_avx512(d4, d1);
+            assert(d4 == d2);
+            assert(vlu_items_avx512(d2.data(), d2.size()) == d1.size());
+            vlu_decode_vec_avx512(d3, d2);
+            assert(d3 == d1);
+        }
+#endif
+
+        /* stream codecs with packets split at every offset */
+        std::vector<uint8_t> d5;
+        vlu_stream_encoder enc([&](const uint8_t *data, size_t len) {
+            d5.insert(d5.end(), data, data + len);
+        }, 3 + n % 13);
+        enc.put(d1.data(), d1.size());
+        enc.flush();
+        assert(d5 == d2);
+        vlu_stream_decoder dec;
+        d3.assign(d1.size(), 0);
+        size_t o = 0, chunk = 1 + n % 11;
+        for (size_t i = 0; i < d2.size(); i += chunk) {
+            size_t len = std::min(chunk, d2.size() - i);
+            vlu_io_result r = dec.decode(d3.data() + o, d3.size() - o, d2.data() + i, len);
+            assert(r.nread == len);
+            o += r.nwritten;
+        }
+        assert(dec.pending() == 0 && o == d1.size() && d3 == d1);
+    }
+}
+
+void test_roundtrip_svlu()
+{
+    bench_random random;
+
+    assert(svlu_zigzag(0) == 0 && svlu_zigzag(-1) == 1 && svlu_zigzag(1) == 2);
+    assert(svlu_zigzag(std::numeric_limits<int64_t>::min()) == 0xffffffffffffffff);
+    assert(svlu_zigzag(std::numeric_limits<int64_t>::max()) == 0xfffffffffffffffe);
+    assert(svlu_encoded_size_64(-64) == 1 && svlu_encoded_size_64(64) == 2);
+    assert(svlu_encoded_size_64(std::numeric_limits<int64_t>::min()) == 10);
+    assert(svlu_encode_56(-1).val == 0b10 && svlu_encode_56(-1).shamt == 1);
+    assert(svlu_decode_56(0b10).val == -1 && svlu_decode_56(0b10).shamt == 1);
+
+    for (int64_t i = -(1ll << 20); i < (1ll << 20); i += 7) {
+        vlu_result_112 e = svlu_encode_64(i);
+        svlu_result d = svlu_decode_64(e.lo, e.hi);
+        assert(d.val == i && d.shamt == e.shamt);
+    }
+
+    for (size_t n = 0; n < 100; n++) {
+        std::vector<int64_t> d1(n * 37), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            uint64_t val = random.pure_56() << 8 | random.pure_8();
+            d1[i] = (int64_t)val >> ((val & 0x3f) | (i % 3 == 0 ? 0 : 32));
+        }
+        svlu_encode_vec(d2, d1);
+        assert(d2.size() == svlu_size_vec(d1));
+        assert(vlu_items_vec(d2) == d1.size());
+        svlu_decode_vec(d3, d2);
+        assert(d3 == d1);
+    }
+}
+
+void test_roundtrip_uvlu_delta()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 20; n++) {
+        std::vector<uint64_t> x(n), y(n);
+        for (size_t i = 0; i < n; i++) x[i] = y[i] = random.pure_56();
+        uint64_t sum = 7;
+        for (size_t i = 0; i < n; i++) y[i] = sum += y[i];
+        assert(vlu_prefix_sum(x.data(), n, 7) == sum && x == y);
+    }
+
+    for (size_t n = 0; n < 100; n++) {
+        std::vector<uint64_t> d1(n * 53), d3;
+        std::vector<uint8_t> d2;
+        uint64_t val = n % 2 ? 0x17e0000000000000 : 0;
+        for (size_t i = 0; i < d1.size(); i++) {
+            /* sorted ids, timestamps with jitter and some unsorted values */
+            switch (n % 3) {
+            case 0: val += random.pure_8(); break;
+            case 1: val += 1000000 + random.pure_8() - 128; break;
+            case 2: val = i % 7 ? val + random.mix_56() : random.pure_56() << 8; break;
+            }
+            d1[i] = val;
+        }
+        vlu_encode_vec_delta(d2, d1);
+        assert(vlu_items_vec(d2) == d1.size());
+        vlu_decode_vec_delta(d3, d2);
+        assert(d3 == d1);
+        vlu_encode_vec_dod(d2, d1);
+        assert(vlu_items_vec(d2) == d1.size());
+        vlu_decode_vec_dod(d3, d2);
+        assert(d3 == d1);
+        if (n % 3 == 1 && d1.size() > 2) {
+            /* constant interval with jitter of 1 byte codes in 2 bytes */
+            assert(d2.size() <= 2 * d1.size() + 20);
+        }
+
+        /* resume part way through with the preceding value and delta */
+        size_t h = d1.size() / 3;
+        if (h < 2) continue;
+        std::vector<uint8_t> d4(vlu_encode_bound(d1.size() - h));
+        vlu_io_result r = vlu_encode_dod(d4.data(), d4.size(), d1.data() + h, d1.size() - h,
+            d1[h-1], d1[h-1] - d1[h-2]);
+        assert(r.nread == d1.size() - h);
+        d3.assign(d1.size() - h, 0);
+        r = vlu_decode_dod(d3.data(), d3.size(), d4.data(), r.nwritten, d1[h-1], d1[h-1] - d1[h-2]);
+        assert(r.nwritten == d3.size() && std::equal(d3.begin(), d3.end(), d1.begin() + h));
+        r = vlu_encode_delta(d4.data(), d4.size(), d1.data() + h, d1.size() - h, d1[h-1]);
+        r = vlu_decode_delta(d3.data(), d3.size(), d4.data(), r.nwritten, d1[h-1]);
+        assert(r.nwritten == d3.size() && std::equal(d3.begin(), d3.end(), d1.begin() + h));
+    }
+}
+
+void test_roundtrip_uvlu_for()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 100; n++) {
+        size_t block = n % 4 == 0 ? 1 : n % 4 == 1 ? 7 : n % 4 == 2 ? 128 : 1024;
+        std::vector<uint64_t> d1(n * 41), d3;
+        std::vector<uint8_t> d2;
+        uint64_t base = random.pure_56() >> 8;
+        for (size_t i = 0; i < d1.size(); i++) {
+            if (i % 500 == 0) base = random.pure_56() >> 8;
+            d1[i] = n % 5 == 0 ? random.pure_56() << 8 | random.pure_8()
+                               : base + (random.pure_56() & 0xfffff);
+        }
+        vlu_encode_vec_for(d2, d1, block);
+        assert(d2.size() == vlu_size_for(d1.data(), d1.size(), block));
+        if (n % 5 != 0 && block > 1 && d1.size() > 0) {
+            assert(d2.size() < vlu_size_vec(d1));
+        }
+        vlu_decode_vec_for(d3, d2);
+        assert(d3 == d1);
+    }
+
+    /* blocks report buffers that are too small or truncated */
+    uint64_t v[3] = { 1000000, 1000001, 1000002 };
+    uint8_t buf[16];
+    assert(vlu_encode_for(buf, 4, v, 3).nread == 0);
+    vlu_io_result r = vlu_encode_for(buf, sizeof(buf), v, 3);
+    assert(r.nread == 3 && r.nwritten == 6);
+    uint64_t w[3];
+    assert(vlu_decode_for(w, 3, buf, 5).nread == 0);
+    assert(vlu_decode_for(w, 3, buf, 6).nread == 6);
+    assert(w[0] == v[0] && w[1] == v[1] && w[2] == v[2]);
+}
+
+void test_roundtrip_uvlu_group()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 200; n++) {
+        std::vector<uint64_t> d1(n < 100 ? n : n * 37), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = n % 4 == 0 ? random.pure_8() : n % 4 == 1 ? random.pure_56() :
+                n % 4 == 2 ? random.mix_56() : random.mix_56() << (i % 9);
+        }
+        vlu_encode_vec_group(d2, d1);
+        size_t h = vlu_encoded_size_56(d1.size());
+        assert(d2.size() == h + vlu_size_group(d1.data(), d1.size()));
+
+        /* no larger than the interleaved layout plus the control bytes */
+        size_t c = (d1.size() + 7) / 8 * 3;
+        assert(d2.size() - h <= vlu_size(d1.data(), d1.size()) + c);
+
+        vlu_decode_vec_group(d3, d2);
+        assert(d3 == d1);
+
+        /* the scalar and SIMD kernels agree */
+        std::vector<uint8_t> d4(vlu_group_bound(d1.size()));
+        vlu_io_result r = vlu_encode_group_scalar(d4.data(), d4.size(), d1.data(), d1.size());
+        assert(r.nwritten == d2.size() - h && std::equal(d2.begin() + h, d2.end(), d4.begin()));
+        r = vlu_decode_group_scalar(d3.data(), d3.size(), d2.data() + h, d2.size() - h);
+        assert(r.nread == d2.size() - h && d3 == d1);
+
+        if (d1.size() > 0) {
+            size_t len = d2.size() - h;
+            assert(vlu_decode_group(d3.data(), d3.size(), d2.data() + h, len - 1).nread == 0);
+        }
+    }
+
+    /* values are stored as their low bytes without a prefix */
+    std::vector<uint64_t> d5 = { 1, 1ull << 60, 3 }, d7;
+    std::vector<uint8_t> d6;
+    vlu_encode_vec_group(d6, d5);
+    assert(d6.size() == 1 + 3 + 1 + 8 + 1);
+    assert(d6[1] == 0x38 && d6[4] == 0x01 && d6[12] == 0x10 && d6[13] == 0x03);
+    vlu_decode_vec_group(d7, d6);
+    assert(d7 == d5);
+
+    d5.assign(40, ~0ull);
+    d5[0] = d5[9] = 1;
+    d5[17] = 1ull << 56;
+    d5[26] = (1ull << 56) - 1;
+    vlu_encode_vec_group(d6, d5);
+    assert(d6.size() == 1 + 15 + 36 * 8 + 2 + 8 + 7);
+    vlu_decode_vec_group(d7, d6);
+    assert(d7 == d5);
+
+    /* capacity */
+    d5.assign(20, 1);
+    d6.resize(vlu_group_bound(d5.size()));
+    assert(vlu_encode_group(d6.data(), d6.size(), d5.data(), d5.size()).nwritten == 29);
+    assert(vlu_encode_group(d6.data(), 28, d5.data(), d5.size()).nread == 0);
+}
+
+static_assert(std::is_same<std::iterator_traits<vlu_array::iterator>::iterator_category,
+    std::input_iterator_tag>::value, "vlu_array::iterator");
+static_assert(!std::is_convertible<size_t, vlu_array>::value, "vlu_array");
+
+void test_array_uvlu()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 60; n++) {
+        size_t sample = n % 3 == 0 ? 1 : n % 3 == 1 ? 7 : 64;
+        std::vector<uint64_t> d1(n * 29), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = i % 11 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+
+        vlu_array a(d1, sample);
+        assert(a.size() == d1.size() && a.bytes() == vlu_size_vec(d1));
+        for (size_t i = 0; i < d1.size(); i++) {
+            assert(a[i] == d1[i]);
+        }
+        d3.assign(a.begin(), a.end());
+        assert(d3 == d1);
+
+        /* decode a range from the middle */
+        size_t h = d1.size() / 3;
+        d3.assign(d1.size(), 0);
+        assert(a.decode(d3.data(), h, d1.size()) == d1.size() - h);
+        assert(std::equal(d3.begin(), d3.begin() + d1.size() - h, d1.begin() + h));
+
+        /* index packed bytes, dropping a truncated packet */
+        vlu_encode_vec(d2, d1);
+        vlu_array b(sample);
+        b.assign_packed(d2.data(), d2.size());
+        assert(b.size() == d1.size() && b.bytes() == d2.size());
+        size_t i = 0;
+        for (uint64_t v : b) assert(v == d1[i++]);
+        if (d2.size() > 0 && d1.back() > 127) {
+            b.assign_packed(d2.data(), d2.size() - 1);
+            assert(b.size() == d1.size() - 1);
+            assert(b.bytes() == d2.size() - vlu_encoded_size_64(d1.back()));
+        }
+        b.assign_packed(nullptr, 0);
+        assert(b.size() == 0 && b.bytes() == 0);
+    }
+}
+
+void test_rank_select_uvlu()
+{
+    bench_random random;
+
+    assert(vlu_select_64(0b101100, 0) == 2 && vlu_select_64(0b101100, 2) == 5);
+    assert(vlu_select_64(1ull << 63, 0) == 63);
+
+    for (size_t n = 0; n < 60; n++) {
+        std::vector<uint64_t> d1(n * n * 7);
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = n % 3 == 0 ? random.pure_8() : i % 7 == 0 ?
+                random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+        vlu_encode_vec(d2, d1);
+        vlu_rank_select rs(d2.data(), d2.size());
+        assert(rs.size() == d1.size());
+        assert(rs.bits.size() * 64 - d2.size() < vlu_rank_select::block_bits);
+
+        size_t o = 0;
+        for (size_t i = 0; i < d1.size(); i++) {
+            assert(rs.select(i) == o);
+            assert(rs.rank(o) == i && rs.rank(o + 1) == i + 1);
+            uint64_t v;
+            vlu_io_result r = vlu_decode(&v, 1, d2.data() + o, d2.size() - o);
+            assert(v == d1[i]);
+            o += r.nread;
+        }
+        assert(rs.rank(d2.size()) == d1.size());
+    }
+}
+
+void test_skip_uvlu()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<uint64_t> d1(n * 13);
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = n % 4 == 0 ? random.pure_8() : n % 4 == 1 ? random.pure_56() :
+                i % 5 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+        vlu_encode_vec(d2, d1);
+
+        /* offsets after each value, and with the last byte cut off */
+        std::vector<size_t> off(1, 0);
+        for (size_t i = 0; i < d1.size(); i++) {
+            off.push_back(off.back() + vlu_encoded_size_64(d1[i]));
+        }
+        for (size_t cut = 0; cut < 2 && cut <= d2.size(); cut++) {
+            const uint8_t *s = d2.data(), *e = s + d2.size() - cut;
+            size_t m = cut ? d1.size() - 1 : d1.size();
+            for (size_t k = 0; k <= d1.size() + 1; k++) {
+                size_t o = off[std::min(k, m)];
+                assert(vlu_skip(s, e, k) == s + o);
+                assert(vlu_skip_scalar(s, e - s, 0, k) == o);
+#if USE_AVX2
+                if (vlu_cpu_avx2()) {
+                    assert(vlu_skip_avx2(s, e - s, k) == o);
+                }
+#endif
+#if USE_AVX512_VBMI2
+                if (vlu_cpu_avx512vbmi2()) {
+                    assert(vlu_skip_avx512(s, e - s, k) == o);
+                }
+#endif
+            }
+        }
+    }
+}
+
+void test_parallel_encode_uvlu()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<uint64_t> d1(n * n * 31), d3;
+        std::vector<uint8_t> d2, d4;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = i % 13 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+        vlu_encode_vec(d2, d1);
+        for (size_t t = 0; t <= 8; t += 1 + t) {
+            vlu_encode_vec_parallel(d4, d1, t);
+            assert(d4 == d2);
+        }
+        std::vector<uint8_t> d5(d2.size());
+        vlu_io_result r = vlu_encode_parallel(d5.data(), d5.size(), d1.data(), d1.size(), 3);
+        assert(r.nread == d1.size() && r.nwritten == d2.size() && d5 == d2);
+        if (d2.size() > 0) {
+            r = vlu_encode_parallel(d5.data(), d5.size() - 1, d1.data(), d1.size(), 3);
+            assert(r.nread == 0 && r.nwritten == 0);
+        }
+    }
+}
+
+void test_parallel_decode_uvlu()
+{
+    bench_random random;
+
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<uint64_t> d1(n * n * 31), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            d1[i] = i % 7 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+        vlu_encode_vec(d2, d1);
+        for (size_t t = 0; t <= 40; t += 1 + t / 4) {
+            vlu_decode_vec_parallel(d3, d2, t);
+            assert(d3 == d1);
+        }
+        std::vector<uint64_t> d4(d1.size());
+        vlu_io_result r = vlu_decode_parallel(d4.data(), d4.size(), d2.data(), d2.size(), 5);
+        assert(r.nread == d2.size() && r.nwritten == d1.size() && d4 == d1);
+        if (d1.size() > 0) {
+            r = vlu_decode_parallel(d4.data(), d4.size() - 1, d2.data(), d2.size(), 5);
+            assert(r.nread == 0 && r.nwritten == 0);
+        }
+    }
+
+    /* all bytes 0x7f, parses from different offsets never meet */
+    std::vector<uint64_t> d1(1000, 0x7f7f7f7f7f7f7full), d3;
+    std::vector<uint8_t> d2;
+    vlu_encode_vec(d2, d1);
+    for (size_t t = 1; t <= 16; t++) {
+        vlu_decode_vec_parallel(d3, d2, t);
+        assert(d3 == d1);
+    }
+}
+
+void test_batch_uvlu()
+{
+    bench_random random;
+
+    std::vector<std::vector<uint64_t>> in(500);
+    size_t values = 0;
+    for (size_t j = 0; j < in.size(); j++) {
+        in[j].resize(j % 11 == 0 ? 0 : random.pure_8() * 4);
+        for (size_t i = 0; i < in[j].size(); i++) {
+            in[j][i] = i % 9 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+        }
+        values += in[j].size();
+    }
+
+    for (size_t t = 0; t <= 8; t += 1 + t) {
+        std::vector<std::vector<uint8_t>> packed(in.size());
+        std::vector<std::vector<uint64_t>> out(in.size());
+        std::vector<vlu_batch_encode_job> ejobs;
+        std::vector<vlu_batch_decode_job> djobs;
+        for (size_t j = 0; j < in.size(); j++) {
+            ejobs.push_back(vlu_batch_encode_job{ in[j].data(), in[j].size(), &packed[j] });
+        }
+        vlu_batch_stats es = vlu_encode_batch(ejobs, t);
+        size_t bytes = 0;
+        for (size_t j = 0; j < in.size(); j++) {
+            std::vector<uint8_t> buf;
+            vlu_encode_vec(buf, in[j]);
+            assert(packed[j] == buf);
+            bytes += buf.size();
+            djobs.push_back(vlu_batch_decode_job{ packed[j].data(), packed[j].size(), &out[j] });
+        }
+        assert(es.jobs == in.size() && es.values == values && es.bytes == bytes);
+        vlu_batch_stats ds = vlu_decode_batch(djobs, t);
+        assert(ds.jobs == in.size() && ds.values == values && ds.bytes == bytes);
+        assert(out == in);
+    }
+
+    vlu_batch_stats s = vlu_encode_batch(std::vector<vlu_batch_encode_job>(), 4);
+    assert(s.jobs == 0 && s.threads == 1);
+}
+
+static_assert(vlu_const_encoded_size_56(0) == 1, "vlu_const_encoded_size_56");
+static_assert(vlu_const_encoded_size_56(300) == 2, "vlu_const_encoded_size_56");
+static_assert(vlu_const_encoded_size_64(~0ull) == 10, "vlu_const_encoded_size_64");
+static_assert(vlu_const_encode_56(300).val == 0x4b1, "vlu_const_encode_56");
+static_assert(vlu_const_decode_56(0x4b1).val == 300, "vlu_const_decode_56");
+static_assert(vlu_const_decode_56(0x4b1).shamt == 2, "vlu_const_decode_56");
+static_assert(vlu_literal<0>::size == 1 && vlu_literal<300>::size == 2, "vlu_literal");
+
+template <uint64_t N>
+void test_literal_uvlu()
+{
+    std::vector<uint64_t> d1(1, N);
+    std::vector<uint8_t> d2;
+    vlu_encode_vec(d2, d1);
+    assert(d2.size() == vlu_literal<N>::size);
+    assert(std::equal(d2.begin(), d2.end(), vlu_literal<N>::value.begin()));
+}
+
+void test_const_uvlu()
+{
+    bench_random random;
+
+    for (size_t i = 0; i < 10000; i++) {
+        uint64_t val = i < 64 ? 1ull << i : random.mix_56();
+        uint64_t limit = 1 + i % 8;
+        vlu_result r1 = vlu_encode_56(val, limit), r2 = vlu_const_encode_56(val, limit);
+        assert(r1.val == r2.val && r1.shamt == r2.shamt);
+        assert(vlu_encoded_size_56(val, limit) == vlu_const_encoded_size_56(val, limit));
+        assert(vlu_encoded_size_64(val) == vlu_const_encoded_size_64(val));
+        uint64_t vlu = random.pure_56() << 8 | random.pure_8();
+        r1 = vlu_decode_56(vlu, limit), r2 = vlu_const_decode_56(vlu, limit);
+        assert(r1.val == r2.val && r1.shamt == r2.shamt);
+    }
+
+    test_literal_uvlu<0>();
+    test_literal_uvlu<127>();
+    test_literal_uvlu<128>();
+    test_literal_uvlu<300>();
+    test_literal_uvlu<(1ull << 56) - 1>();
+    test_literal_uvlu<1ull << 56>();
+    test_literal_uvlu<~0ull>();
+}
+
+template <typename C>
+void test_codec_roundtrip(bench_random &random)
+{
+    typedef typename C::word_type W;
+
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<W> d1(n * n * 7), d3;
+        std::vector<uint8_t> d2;
+        for (size_t i = 0; i < d1.size(); i++) {
+            W x = 0;
+            for (size_t k = 0; k < sizeof(W); k++) x = W(W(x << 8) | W(random.pure_8()));
+            d1[i] = W(x >> (random.pure_8() % C::word_bits));
+        }
+        C::encode_vec(d2, d1);
+        assert(d2.size() == C::size(d1.data(), d1.size()));
+        assert(C::items(d2.data(), d2.size()) == d1.size());
+        C::decode_vec(d3, d2);
+        assert(d3 == d1);
+        if (d2.size() == 0) continue;
+
+        /* truncated input decodes a prefix of the values */
+        vlu_io_result r = C::decode(d3.data(), d3.size(), d2.data(), d2.size() - 1);
+        assert(r.nwritten < d1.size() && r.nread <= d2.size() - 1);
+        assert(std::equal(d3.begin(), d3.begin() + r.nwritten, d1.begin()));
+
+        /* a short buffer encodes a prefix of the values */
+        std::vector<uint8_t> d4(d2.size() / 2);
+        r = C::encode(d4.data(), d4.size(), d1.data(), d1.size());
+        assert(r.nread < d1.size() && r.nwritten <= d4.size());
+        assert(C::items(d4.data(), r.nwritten) == r.nread);
+    }
+}
+
+void test_codec_uvlu()
+{
+    bench_random random;
+
+    test_codec_roundtrip<vlu4_codec>(random);
+    test_codec_roundtrip<vlu8_codec>(random);
+    test_codec_roundtrip<vlu8_32_codec>(random);
+    test_codec_roundtrip<vlu16_codec>(random);
+    test_codec_roundtrip<vlu_codec<4, 3, uint32_t>>(random);
+#if defined(__SIZEOF_INT128__)
+    test_codec_roundtrip<vlu8_16_codec>(random);
+#endif
+
+    /* vlu8_codec is the format of vlu_encode */
+    std::vector<uint64_t> d1(1000);
+    std::vector<uint8_t> d2, d3;
+    for (size_t i = 0; i < d1.size(); i++) {
+        d1[i] = i % 7 == 0 ? random.pure_56() << 8 | random.pure_8() : random.mix_56();
+    }
+    vlu_encode_vec(d2, d1);
+    vlu8_codec::encode_vec(d3, d1);
+    assert(d2 == d3);
+
+    /* nibble units halve the size of values below 8 */
+    std::vector<uint64_t> d4(1000);
+    for (size_t i = 0; i < d4.size(); i++) d4[i] = random.pure_8() & 7;
+    assert(vlu4_codec::size(d4.data(), d4.size()) * 2 == vlu_size(d4.data(), d4.size()));
+
+    /* a terminal carrying bits above the word is rejected */
+    uint8_t b1[10] = { 0xff, 0, 0, 0, 0, 0, 0, 0, 0xfd, 0x03 };
+    uint64_t v1 = 0;
+    assert(vlu8_codec::decode(&v1, 1, b1, 10).nwritten == 1 && v1 == 0xffull << 56);
+    b1[8] = 0x01; b1[9] = 0x04;
+    assert(vlu8_codec::decode(&v1, 1, b1, 10).nwritten == 0);
+    assert(vlu8_codec::items(b1, 10) == 0);
+
+#if defined(__SIZEOF_INT128__)
+    /* vlu8_16_codec is the format of vlu_encode_buf_112 */
+    std::vector<vlu_u128> d5(1000);
+    std::vector<vlu_uint128> d6(d5.size());
+    for (size_t i = 0; i < d5.size(); i++) {
+        d5[i] = vlu_u128{ random.pure_56() << 8 | random.pure_8(), random.pure_56() >> (i % 56) };
+        if (i % 5 == 0) d5[i].hi |= ~0ull << 56;
+        d6[i] = vlu_uint128(d5[i].hi) << 64 | d5[i].lo;
+    }
+    std::vector<uint8_t> d7(vlu_size_112(d5.data(), d5.size()) + 16), d8;
+    vlu_io_result r = vlu_encode_buf_112(d7.data(), d7.size(), d5.data(), d5.size());
+    d7.resize(r.nwritten);
+    vlu8_16_codec::encode_vec(d8, d6);
+    assert(d7 == d8);
+#endif
+}
+
 void test_encode_uleb()
 {
     bench_random random;
@@ -208,6 +1254,18 @@ void test_encode_uleb()
         uint64_t val = random.mix_56();
         assert(leb_decode_56(leb_encode_56(val).val).val == val);
     }
+
+#if USE_BMI2
+    if (vlu_cpu_bmi2()) {
+        for (size_t i = 0; i < 1000; i++) {
+            uint64_t leb = random.pure_56() << 8 | random.pure_8();
+            leb |= i % 3 ? 0 : 0x8080808080808080ull;
+            vlu_result r1 = leb_decode_56(leb), r2 = leb_decode_56_bmi2(leb);
+            assert(r1.val == r2.val && r1.shamt == r2.shamt);
+            assert(leb_decoded_size_56(leb) == leb_decoded_size_56_bmi2(leb));
+        }
+    }
+#endif
 }
 
 void test_roundtrip_uleb_u7()
@@ -271,10 +1329,38 @@ void test_roundtrip_uleb_u21()
 
 void run_tests()
 {
+    test_bits();
     test_encode_uvlu();
     test_roundtrip_uvlu_u7();
     test_roundtrip_uvlu_u14();
     test_roundtrip_uvlu_u21();
+    test_items_uvlu();
+    test_buffer_uvlu();
+    test_checked_uvlu();
+    test_stream_uvlu();
+    test_stream_encode_uvlu();
+#if USE_AVX2
+    test_roundtrip_uvlu_avx2();
+#endif
+#if USE_AVX512_VBMI2
+    test_roundtrip_uvlu_avx512();
+#endif
+    test_encode_uvlu_112();
+    test_roundtrip_uvlu_112();
+    test_roundtrip_uvlu_big();
+    test_roundtrip_uvlu_64();
+    test_roundtrip_svlu();
+    test_roundtrip_uvlu_delta();
+    test_roundtrip_uvlu_for();
+    test_roundtrip_uvlu_group();
+    test_array_uvlu();
+    test_rank_select_uvlu();
+    test_skip_uvlu();
+    test_parallel_encode_uvlu();
+    test_parallel_decode_uvlu();
+    test_batch_uvlu();
+    test_const_uvlu();
+    test_codec_uvlu();
     test_encode_uleb();
     test_roundtrip_uleb_u7();
     test_roundtrip_uleb_u14();